@@ -1,7 +1,7 @@
 TARGET = acquisition
 TEMPLATE = app
 
-QT += core gui network webenginewidgets testlib
+QT += core gui network webenginewidgets testlib concurrent
 
 win32 {
     QT += winextras
@@ -34,11 +34,17 @@ SOURCES += \
     src/geartypefilter.cpp \
     src/geartypelist.cpp \
     src/imagecache.cpp \
+    src/internedstring.cpp \
     src/item.cpp \
+    src/itemarena.cpp \
+    src/itemcolumns.cpp \
     src/itemlocation.cpp \
+    src/itemparser.cpp \
     src/items_model.cpp \
     src/itemsmanager.cpp \
     src/itemsmanagerworker.cpp \
+    src/itemsrequestqueue.cpp \
+    src/itemsnapshot.cpp \
     src/itemtooltip.cpp \
     src/logindialog.cpp \
     src/logpanel.cpp \
@@ -46,22 +52,34 @@ SOURCES += \
     src/mainwindow.cpp \
     src/memorydatastore.cpp \
     src/modlist.cpp \
+    src/modtable.cpp \
     src/modsfilter.cpp \
     src/porting.cpp \
+    src/ratelimiter.cpp \
+    src/refreshcheckpoint.cpp \
     src/replytimeout.cpp \
     src/search.cpp \
     src/shop.cpp \
     src/steamlogindialog.cpp \
     src/tabcache.cpp \
+    src/trigramindex.cpp \
     src/updatechecker.cpp \
     src/util.cpp \
     src/version.cpp \
     src/verticalscrollarea.cpp \
     test/testdata.cpp \
+    test/testdatastore.cpp \
+    test/testfilters.cpp \
     test/testitem.cpp \
+    test/testitemcolumns.cpp \
     test/testitemsmanager.cpp \
+    test/testitemsrequestqueue.cpp \
     test/testmain.cpp \
+    test/testmodlist.cpp \
+    test/testratelimiter.cpp \
+    test/testrefreshcheckpoint.cpp \
     test/testshop.cpp \
+    test/testtrigramindex.cpp \
     test/testutil.cpp
 
 HEADERS += \
@@ -80,37 +98,55 @@ HEADERS += \
     src/geartypefilter.h \
     src/geartypelist.h \    
     src/imagecache.h \
+    src/internedstring.h \
     src/item.h \
+    src/itemarena.h \
+    src/itemcolumns.h \
     src/itemconstants.h \
     src/itemlocation.h \
+    src/itemparser.h \
     src/items_model.h \
     src/itemsmanager.h \
     src/itemsmanagerworker.h \
+    src/itemsrequestqueue.h \
+    src/itemsnapshot.h \
     src/itemtooltip.h \
     src/logindialog.h \
     src/logpanel.h \
     src/mainwindow.h \
     src/memorydatastore.h \
     src/modlist.h \
+    src/modtable.h \
     src/modsfilter.h \
     src/porting.h \
     src/rapidjson_util.h \
+    src/ratelimiter.h \
+    src/refreshcheckpoint.h \
     src/replytimeout.h \
     src/search.h \
     src/selfdestructingreply.h \
     src/shop.h \
     src/steamlogindialog.h \
     src/tabcache.h \
+    src/trigramindex.h \
     src/updatechecker.h \
     src/util.h \
     src/version.h \
     src/version_defines.h \
     src/verticalscrollarea.h \
     test/testdata.h \
+    test/testdatastore.h \
+    test/testfilters.h \
     test/testitem.h \
+    test/testitemcolumns.h \
     test/testitemsmanager.h \
+    test/testitemsrequestqueue.h \
     test/testmain.h \
+    test/testmodlist.h \
+    test/testratelimiter.h \
+    test/testrefreshcheckpoint.h \
     test/testshop.h \
+    test/testtrigramindex.h \
     test/testutil.h
 
 FORMS += \
@@ -65,7 +65,14 @@ void Application::InitLogin(std::unique_ptr<QNetworkAccessManager> login_manager
 }
 
 void Application::OnItemsRefreshed(bool initial_refresh) {
-    currency_manager_->Update();
+    if (initial_refresh) {
+        currency_manager_->Update();
+    } else {
+        // Nothing changed so neither did the shop
+        if (items_manager_->changes().empty())
+            return;
+        currency_manager_->Update(items_manager_->changes());
+    }
     shop_->Update();
     if (!initial_refresh && shop_->auto_update())
         shop_->SubmitShopToForum();
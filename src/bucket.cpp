@@ -1,6 +1,9 @@
 #include "bucket.h"
 #include "QMessageBox"
 
+#include <algorithm>
+#include <vector>
+
 // this is required by std::map's operator[]
 Bucket::Bucket()
 {}
@@ -13,6 +16,10 @@ void Bucket::AddItem(const std::shared_ptr<Item> & item) {
     items_.push_back(item);
 }
 
+void Bucket::AddItems(const Items &items) {
+    items_.insert(items_.end(), items.begin(), items.end());
+}
+
 const std::shared_ptr<Item> &Bucket::item(int row) const
 {   
     if (row < 0 || row >= items_.size()) {
@@ -26,10 +33,23 @@ const std::shared_ptr<Item> &Bucket::item(int row) const
 
 void Bucket::Sort(const Column &column, Qt::SortOrder order)
 {
-    std::sort(begin(items_), end(items_), [&](const std::shared_ptr<Item>& lhs, const std::shared_ptr<Item>& rhs) {
-        if (order == Qt::AscendingOrder) {
-            return column.lt(rhs.get(),lhs.get());
-        }
-        return column.lt(lhs.get(),rhs.get());
+    // Keys are worked out once per item, comparisons only look at them
+    std::vector<SortKey> keys;
+    keys.reserve(items_.size());
+    for (auto &item : items_)
+        keys.push_back(column.sort_key(*item));
+    std::vector<size_t> indexes(items_.size());
+    for (size_t i = 0; i < indexes.size(); ++i)
+        indexes[i] = i;
+    std::sort(indexes.begin(), indexes.end(), [&](size_t lhs, size_t rhs) {
+        if (order == Qt::AscendingOrder)
+            return keys[rhs] < keys[lhs];
+        return keys[lhs] < keys[rhs];
     });
+
+    Items sorted;
+    sorted.reserve(items_.size());
+    for (auto i : indexes)
+        sorted.push_back(items_[i]);
+    items_ = std::move(sorted);
 }
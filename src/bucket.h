@@ -12,6 +12,7 @@ public:
     Bucket();
     explicit Bucket(const ItemLocation &location);
     void AddItem(const std::shared_ptr<Item> &item);
+    void AddItems(const Items &items);
     const Items &items() const { return items_; }
     const std::shared_ptr<Item> &item(int row) const;
     const ItemLocation &location() const { return location_; }
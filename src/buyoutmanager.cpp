@@ -193,7 +193,8 @@ const std::map<std::string, Currency> BuyoutManager::string_to_currency_type_ =
 
 BuyoutManager::BuyoutManager(DataStore &data) :
     data_(data),
-    save_needed_(false)
+    save_needed_(false),
+    generation_(0)
 {
     Load();
 }
@@ -204,10 +205,12 @@ void BuyoutManager::Set(const Item &item, const Buyout &buyout) {
         // Entry exists - we don't want to update if buyout is equal to existing
         if (buyout != it->second) {
             save_needed_ = true;
+            ++generation_;
             it->second = buyout;
         }
     } else {
         save_needed_ = true;
+        ++generation_;
         buyouts_.insert(it, {item.hash(), buyout});
     }
 }
@@ -234,10 +237,12 @@ void BuyoutManager::SetTab(const std::string &tab, const Buyout &buyout) {
         // Entry exists - we don't want to update if buyout is equal to existing
         if (buyout != it->second) {
             save_needed_ = true;
+            ++generation_;
             it->second = buyout;
         }
     } else {
         save_needed_ = true;
+        ++generation_;
         tab_buyouts_.insert(it, {tab, buyout});
     }
 }
@@ -253,6 +258,7 @@ void BuyoutManager::CompressTabBuyouts() {
     for (auto it = tab_buyouts_.begin(), ite = tab_buyouts_.end(); it != ite;) {
         if(tmp.count(it->first) == 0) {
             save_needed_ = true;
+            ++generation_;
             it = tab_buyouts_.erase(it);
         } else {
             ++it;
@@ -272,7 +278,7 @@ void BuyoutManager::CompressItemBuyouts(const Items &items) {
 
     for (auto it = buyouts_.cbegin(); it != buyouts_.cend();) {
         if (tmp.count(it->first) == 0) {
-
+            ++generation_;
             buyouts_.erase(it++);
         } else {
             ++it;
@@ -280,6 +286,11 @@ void BuyoutManager::CompressItemBuyouts(const Items &items) {
     }
 }
 
+void BuyoutManager::Remove(const std::string &hash) {
+    if (buyouts_.erase(hash))
+        ++generation_;
+}
+
 void BuyoutManager::SetRefreshChecked(const ItemLocation &loc, bool value) {
     save_needed_ = true;
     refresh_checked_[loc.GetUniqueHash()] = value;
@@ -303,8 +314,13 @@ void BuyoutManager::ClearRefreshLocks() {
     refresh_locked_.clear();
 }
 
+void BuyoutManager::ClearRefreshLock(const ItemLocation &loc) {
+    refresh_locked_.erase(loc.GetUniqueHash());
+}
+
 void BuyoutManager::Clear() {
     save_needed_ = true;
+    ++generation_;
     buyouts_.clear();
     tab_buyouts_.clear();
     refresh_locked_.clear();
@@ -425,6 +441,7 @@ void BuyoutManager::Save() {
 }
 
 void BuyoutManager::Load() {
+    ++generation_;
     Deserialize(data_.Get("buyouts"), &buyouts_);
     Deserialize(data_.Get("tab_buyouts"), &tab_buyouts_);
     Deserialize(data_.Get("refresh_checked_state"), refresh_checked_);
@@ -482,6 +499,7 @@ void BuyoutManager::MigrateItem(const Item &item) {
         buyouts_[hash] = it->second;
         buyouts_.erase(it);
         save_needed_ = true;
+        ++generation_;
     }
 }
 
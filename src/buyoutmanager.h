@@ -152,6 +152,8 @@ public:
     Buyout GetTab(const std::string &tab) const;
     void CompressTabBuyouts();
     void CompressItemBuyouts(const Items &items);
+    // Removes the buyout of an item that no longer exists
+    void Remove(const std::string &hash);
 
     void SetRefreshChecked(const ItemLocation &tab, bool value);
     bool GetRefreshChecked(const ItemLocation &tab) const;
@@ -159,6 +161,7 @@ public:
     bool GetRefreshLocked(const ItemLocation &tab) const;
     void SetRefreshLocked(const ItemLocation &tab);
     void ClearRefreshLocks();
+    void ClearRefreshLock(const ItemLocation &tab);
 
     void SetStashTabLocations(const std::vector<ItemLocation> &tabs);
     const std::vector<ItemLocation> GetStashTabLocations() const;
@@ -170,6 +173,8 @@ public:
     void Load();
 
     void MigrateItem(const Item &item);
+    // Changes whenever a buyout is set or removed
+    unsigned generation() const { return generation_; }
 private:
     Currency StringToCurrencyType(std::string currency) const;
     BuyoutType StringToBuyoutType(std::string bo_str) const;
@@ -186,6 +191,7 @@ private:
     std::map<std::string, bool> refresh_checked_;
     std::set<std::string> refresh_locked_;
     bool save_needed_;
+    unsigned generation_;
     std::vector<ItemLocation> tabs_;
     static const std::map<std::string, BuyoutType> string_to_buyout_type_;
     static const std::map<std::string, Currency> string_to_currency_type_;
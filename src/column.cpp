@@ -20,6 +20,8 @@
 #include "column.h"
 
 #include <cmath>
+#include <limits>
+#include <tuple>
 #include <QVector>
 #include <QRegularExpression>
 
@@ -34,34 +36,38 @@ QColor Column::color(const Item & /* item */) const {
     return QColor();
 }
 
-std::tuple<QVariant, QVariant, const Item&> Column::multivalue(const Item* item) const {
-    // Transform values into something optimal for sorting
+bool SortKey::operator<(const SortKey &other) const {
+    auto lhs = std::tie(kind, number, text, second_number, second_text);
+    auto rhs = std::tie(other.kind, other.number, other.text, other.second_number, other.second_text);
+    if (lhs != rhs)
+        return lhs < rhs;
+    return *item < *other.item;
+}
+
+SortKey Column::sort_key(const Item &item) const {
     // Possibilities: 12, 12.12, 10%, 10.13%, +16%, 12-14, 10/20
-    QVariant sort_first_by;
-    QVariant sort_second_by;
+    SortKey key;
+    key.item = &item;
 
-    QString str = value(*item).toString();
+    QString str = value(item).toString();
     QRegularExpressionMatch match;
 
     if (str.contains(sort_double_match, &match)) {
-        sort_first_by = match.captured(1).toDouble();
+        key.number = match.captured(1).toDouble();
     } else if (str.contains(sort_two_values, &match)) {
         if (match.captured(2).startsWith("-")) {
-            sort_first_by = 0.5 * (match.captured(1).toDouble() + match.captured(3).toDouble());
+            key.number = 0.5 * (match.captured(1).toDouble() + match.captured(3).toDouble());
         } else {
-            sort_first_by = item->PrettyName().c_str();
-            sort_second_by = match.captured(1).toDouble();
+            key.kind = 1;
+            key.text = item.PrettyName();
+            key.second_number = match.captured(1).toDouble();
         }
     } else {
-        sort_first_by = str;
-        sort_second_by = item->PrettyName().c_str();
+        key.kind = 1;
+        key.text = str.toStdString();
+        key.second_text = item.PrettyName();
     }
-
-    return std::forward_as_tuple(sort_first_by, sort_second_by, *item);
-}
-
-bool Column::lt(const Item* lhs, const Item* rhs) const {
-    return multivalue(lhs) < multivalue(rhs);
+    return key;
 }
 
 std::string NameColumn::name() const {
@@ -115,8 +121,9 @@ std::string PropertyColumn::name() const {
 }
 
 QVariant PropertyColumn::value(const Item &item) const {
-    if (item.properties().count(property_))
-        return item.properties().find(property_)->second.c_str();
+    auto it = item.properties().find(property_);
+    if (it != item.properties().end())
+        return it->second.c_str();
     return QVariant();
 }
 
@@ -204,18 +211,13 @@ QColor PriceColumn::color(const Item &item) const {
     return bo.IsInherited() ? QColor(0xaa, 0xaa, 0xaa):QColor();
 }
 
-std::tuple<int, double, const Item&> PriceColumn::multivalue(const Item* item) const {
-    const Buyout &bo = bo_manager_.Get(*item);
-    // forward_as_tuple used to forward item reference properly and avoid ref to temporary
-    // that will be destroyed.  We want item reference because we want to sort based on item
-    // object itself and not the pointer.  I'm not entirely sure I fully understand
-    // this mechanism, but basically want to avoid a ton of Item copies during sorting
-    // so trying to avoid pass by value (ericsium).
-    return std::forward_as_tuple(bo.currency.AsRank(), bo.value, *item);
-}
-
-bool PriceColumn::lt(const Item* lhs, const Item* rhs) const {
-    return multivalue(lhs) < multivalue(rhs);
+SortKey PriceColumn::sort_key(const Item &item) const {
+    const Buyout &bo = bo_manager_.Get(item);
+    SortKey key;
+    key.item = &item;
+    key.number = bo.currency.AsRank();
+    key.second_number = bo.value;
+    return key;
 }
 
 DateColumn::DateColumn(const BuyoutManager &bo_manager):
@@ -231,11 +233,13 @@ QVariant DateColumn::value(const Item &item) const {
     return bo.IsActive() ? Util::TimeAgoInWords(bo.last_update).c_str():QVariant();
 }
 
-bool DateColumn::lt(const Item* lhs, const Item* rhs) const {
-    auto lhs_update_time = bo_manager_.Get(*lhs).last_update;
-    auto rhs_update_time = bo_manager_.Get(*rhs).last_update;
-    return (std::tie(lhs_update_time, *lhs) <
-            std::tie(rhs_update_time, *rhs)) ;
+SortKey DateColumn::sort_key(const Item &item) const {
+    QDateTime last_update = bo_manager_.Get(item).last_update;
+    SortKey key;
+    key.item = &item;
+    // Items that were never updated go first
+    key.number = last_update.isValid() ? last_update.toMSecsSinceEpoch() : std::numeric_limits<double>::lowest();
+    return key;
 }
 
 std::string ItemlevelColumn::name() const {
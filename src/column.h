@@ -27,15 +27,35 @@
 
 class BuyoutManager;
 
+/*
+ * What a column sorts an item by. Buckets compute it once per item when they're
+ * sorted instead of working values out again for every comparison.
+ * Keys with numbers (kind 0) go before keys with texts (kind 1), ties are
+ * broken by the item itself.
+ */
+struct SortKey {
+    SortKey() : kind(0), number(0), second_number(0), item(nullptr) {}
+    int kind;
+    double number;
+    std::string text;
+    double second_number;
+    std::string second_text;
+    const Item *item;
+    bool operator<(const SortKey &other) const;
+};
+
 class Column {
 public:
     virtual std::string name() const = 0;
     virtual QVariant value(const Item &item) const = 0;
     virtual QColor color(const Item &item) const;
-    virtual bool lt(const Item* lhs, const Item* rhs) const;
+    // By default values are sorted as numbers when they look like one (12, 10.13%,
+    // +16%, 12-14) and as text otherwise.
+    virtual SortKey sort_key(const Item &item) const;
+    // Whether value() and color() only change along with the item and its buyout,
+    // ItemsModel keeps them until then.
+    virtual bool cacheable() const { return true; }
     virtual ~Column() {}
-private:
-    std::tuple<QVariant, QVariant, const Item&> multivalue(const Item *item) const;
 };
 
 class NameColumn : public Column {
@@ -60,7 +80,7 @@ public:
     QVariant value(const Item &item) const;
 private:
     std::string name_;
-    std::string property_;
+    InternedString property_;
 };
 
 class DPSColumn : public Column {
@@ -97,9 +117,8 @@ public:
     std::string name() const;
     QVariant value(const Item &item) const;
     QColor color(const Item &item) const;
-    bool lt(const Item *lhs, const Item *rhs) const;
+    SortKey sort_key(const Item &item) const;
 private:
-    std::tuple<int, double, const Item&> multivalue(const Item *item) const;
     const BuyoutManager &bo_manager_;
 };
 
@@ -108,7 +127,9 @@ public:
     explicit DateColumn(const BuyoutManager &bo_manager);
     std::string name() const;
     QVariant value(const Item &item) const;
-    bool lt(const Item *lhs, const Item *rhs) const;
+    SortKey sort_key(const Item &item) const;
+    // "5 minutes ago" changes with the time
+    bool cacheable() const { return false; }
 private:
     const BuyoutManager &bo_manager_;
 };
@@ -75,6 +75,22 @@ void CurrencyManager::Update() {
     dialog_->Update();
 }
 
+void CurrencyManager::Update(const ItemsChangeSet &changes) {
+    for (auto &pair : changes) {
+        const TabChanges &tab = pair.second;
+        for (auto &item : tab.removed)
+            ParseSingleItem(*item, -1);
+        for (auto &modified : tab.modified) {
+            ParseSingleItem(*modified.first, -1);
+            ParseSingleItem(*modified.second);
+        }
+        for (auto &item : tab.added)
+            ParseSingleItem(*item);
+    }
+    SaveCurrencyValue();
+    dialog_->Update();
+}
+
 const double EPS = 1e-6;
 double CurrencyManager::TotalExaltedValue() {
     double out = 0;
@@ -242,14 +258,14 @@ void CurrencyManager::ExportCurrency() {
     }
 }
 
-void CurrencyManager::ParseSingleItem(const Item &item) {
+void CurrencyManager::ParseSingleItem(const Item &item, int count) {
     for (unsigned int i = 0; i < currencies_.size(); i++)
         if (item.PrettyName() == currencies_[i]->name)
-            currencies_[i]->count += item.count();
+            currencies_[i]->count += count * item.count();
 
     for (unsigned int i = 0; i < wisdoms_.size(); i++)
         if (item.PrettyName() == CurrencyForWisdom[i])
-            wisdoms_[i] += item.count();
+            wisdoms_[i] += count * item.count();
 }
 
 void CurrencyManager::DisplayCurrency() {
@@ -166,7 +166,8 @@ public:
     ~CurrencyManager();
     void ClearCurrency();
     // Called in itemmanagerworker::ParseItem
-    void ParseSingleItem(const Item &item);
+    // count is negative for items that are gone
+    void ParseSingleItem(const Item &item, int count = 1);
     //void UpdateBaseValue(int ind, double value);
     const std::vector<std::shared_ptr<CurrencyItem>> &currencies() const { return currencies_;}
     double TotalExaltedValue();
@@ -174,6 +175,8 @@ public:
     int TotalWisdomValue();
     void DisplayCurrency();
     void Update();
+    // Only adjusts the counts for items that changed
+    void Update(const ItemsChangeSet &changes);
     // CSV export
     void ExportCurrency();
 
@@ -24,6 +24,12 @@
 
 #include "currencymanager.h"
 
+// A row of the items table, json is what Item::json() returns
+struct ItemRecord {
+    std::string hash;
+    std::string json;
+};
+
 class DataStore {
 public:
     virtual ~DataStore() {};
@@ -31,6 +37,12 @@ public:
     virtual std::string Get(const std::string &key, const std::string &default_value = "") = 0;
     virtual void InsertCurrencyUpdate(const CurrencyUpdate &update) = 0;
     virtual std::vector<CurrencyUpdate> GetAllCurrency() = 0;
+    // Items are kept per location (stash tab or character) so that refreshing a tab
+    // only rewrites that tab. SetItems replaces everything stored for the location,
+    // it returns false and leaves the stored items as they were if that fails.
+    virtual bool SetItems(const std::string &location, const std::vector<ItemRecord> &items) = 0;
+    virtual std::vector<ItemRecord> GetItems(const std::string &location) = 0;
+    virtual std::vector<std::string> GetItemLocations() = 0;
     virtual void SetBool(const std::string &key, bool value) = 0;
     virtual bool GetBool(const std::string &key, bool default_value = false) = 0;
     virtual void SetInt(const std::string &key, int value) = 0;
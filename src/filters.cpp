@@ -17,6 +17,7 @@
     along with Acquisition.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <limits>
 #include <memory>
 #include <QCheckBox>
 #include <QGroupBox>
@@ -31,10 +32,24 @@ std::unique_ptr<FilterData> Filter::CreateData() {
     return std::make_unique<FilterData>(this);
 }
 
+bool Filter::Narrows(const FilterData &before, const FilterData &after) {
+    return before == after;
+}
+
+bool ModFilterData::operator==(const ModFilterData &other) const {
+    return mod == other.mod && min == other.min && max == other.max
+        && min_filled == other.min_filled && max_filled == other.max_filled;
+}
+
 FilterData::FilterData(Filter *filter):
     text_query(""),
+    min(0),
+    max(0),
     min_filled(false),
     max_filled(false),
+    r(0),
+    g(0),
+    b(0),
     r_filled(false),
     g_filled(false),
     b_filled(false),
@@ -46,6 +61,18 @@ bool FilterData::Matches(const std::shared_ptr<Item> item) {
     return filter_->Matches(item, this);
 }
 
+bool FilterData::Select(const ItemColumns &columns, ItemColumns::Selection *selection) {
+    return filter_->Select(columns, this, selection);
+}
+
+bool FilterData::operator==(const FilterData &other) const {
+    return filter_ == other.filter_ && text_query == other.text_query
+        && min == other.min && max == other.max && min_filled == other.min_filled && max_filled == other.max_filled
+        && r == other.r && g == other.g && b == other.b
+        && r_filled == other.r_filled && g_filled == other.g_filled && b_filled == other.b_filled
+        && checked == other.checked && mod_data == other.mod_data && geartype_data == other.geartype_data;
+}
+
 void FilterData::FromForm() {
     filter_->FromForm(this);
 }
@@ -71,11 +98,39 @@ void NameSearchFilter::ResetForm() {
 }
 
 bool NameSearchFilter::Matches(const std::shared_ptr<Item> &item, FilterData *data) {
-    std::string query = data->text_query;
-    std::string name = item->PrettyName();
-    std::transform(query.begin(), query.end(), query.begin(), ::tolower);
-    std::transform(name.begin(), name.end(), name.begin(), ::tolower);
-    return name.find(query) != std::string::npos;
+    std::string query = TrigramIndex::Lowercase(data->text_query);
+    return TrigramIndex::Lowercase(Text(*item)).find(query) != std::string::npos;
+}
+
+bool NameSearchFilter::Select(const ItemColumns &columns, FilterData *data, ItemColumns::Selection *selection) {
+    if (data->text_query.empty())
+        return true;
+    return columns.SelectText(this, [this](const std::shared_ptr<Item> &item) {
+        return Text(*item);
+    }, data->text_query, selection);
+}
+
+bool NameSearchFilter::Narrows(const FilterData &before, const FilterData &after) {
+    // A name containing the longer query also contains the shorter one
+    std::string before_query = TrigramIndex::Lowercase(before.text_query);
+    return TrigramIndex::Lowercase(after.text_query).find(before_query) != std::string::npos;
+}
+
+ModTextFilter::ModTextFilter(QLayout *parent) :
+    NameSearchFilter(parent)
+{
+    textbox_->setPlaceholderText("Mod text");
+}
+
+std::string ModTextFilter::Text(const Item &item) const {
+    std::string text;
+    for (auto &pair : item.text_mods()) {
+        for (auto &mod : pair.second) {
+            text += mod;
+            text += '\n';
+        }
+    }
+    return text;
 }
 
 void NameSearchFilter::Initialize(QLayout *parent) {
@@ -159,6 +214,22 @@ bool MinMaxFilter::Matches(const std::shared_ptr<Item> &item, FilterData *data)
     }
 }
 
+bool MinMaxFilter::Select(const ItemColumns &columns, FilterData *data, ItemColumns::Selection *selection) {
+    if (!data->min_filled && !data->max_filled)
+        return true;
+    auto &column = columns.Get(this, 0, [this](const std::shared_ptr<Item> &item) {
+        return IsValuePresent(item) ? GetValue(item) : ItemColumns::Missing();
+    });
+    double min = data->min_filled ? data->min : -std::numeric_limits<double>::infinity();
+    double max = data->max_filled ? data->max : std::numeric_limits<double>::infinity();
+    ItemColumns::SelectRange(column, min, max, selection);
+    return true;
+}
+
+bool MinMaxFilter::Narrows(const FilterData &before, const FilterData &after) {
+    return BoundsNarrow(before, after);
+}
+
 bool SimplePropertyFilter::IsValuePresent(const std::shared_ptr<Item> &item) {
     return item->properties().count(property_);
 }
@@ -277,6 +348,13 @@ bool SocketsColorsFilter::Matches(const std::shared_ptr<Item> &item, FilterData
     return Check(need_r, need_g, need_b, sockets.r, sockets.g, sockets.b, sockets.w);
 }
 
+bool SocketsColorsFilter::Narrows(const FilterData &before, const FilterData &after) {
+    // Needing more sockets of a color can only exclude more items
+    return (!before.r_filled || (after.r_filled && after.r >= before.r))
+        && (!before.g_filled || (after.g_filled && after.g >= before.g))
+        && (!before.b_filled || (after.b_filled && after.b >= before.b));
+}
+
 LinksColorsFilter::LinksColorsFilter(QLayout *parent) {
     Initialize(parent, "Linked");
 }
@@ -338,67 +416,97 @@ bool BooleanFilter::Matches(const std::shared_ptr<Item> & /* item */, FilterData
     return true;
 }
 
+bool BooleanFilter::Narrows(const FilterData &before, const FilterData &after) {
+    return !before.checked || after.checked;
+}
+
 bool MTXFilter::Matches(const std::shared_ptr<Item> &item, FilterData *data) {
     return !data->checked || item->has_mtx();
 }
 
-bool AltartFilter::Matches(const std::shared_ptr<Item> &item, FilterData *data) {
-    static std::vector<std::string> altart = {
-        // season 1
-        "RedBeak2.png", "Wanderlust2.png", "Ring2b.png", "Goldrim2.png", "FaceBreaker2.png", "Atzirismirror2.png",
-        // season 2
-        "KaruiWardAlt.png", "ShiverstingAlt.png", "QuillRainAlt.png", "OnyxAmuletAlt.png", "DeathsharpAlt.png", "CarnageHeartAlt.png",
-        "TabulaRasaAlt.png", "andvariusAlt.png", "AstramentisAlt.png",
-        // season 3
-        "BlackheartAlt.png", "SinTrekAlt.png", "ShavronnesPaceAlt.png", "Belt3Alt.png", "EyeofChayulaAlt.png", "SundanceAlt.png",
-        "ReapersPursuitAlt.png", "WindscreamAlt.png", "RainbowStrideAlt.png", "TarynsShiverAlt.png",
-        // season 4
-        "BrightbeakAlt.png", "RubyRingAlt.png", "TheSearingTouchAlt.png", "CloakofFlameAlt.png", "AtzirisFoibleAlt.png", "DivinariusAlt.png",
-        "HrimnorsResolveAlt.png", "CarcassJackAlt.png", "TheIgnomonAlt.png", "HeatShiverAlt.png",
-        // season 5
-        "KaomsSignAlt.png", "StormcloudAlt.png", "FairgravesTricorneAlt.png", "MoonstoneRingAlt.png", "GiftsfromAboveAlt.png", "LeHeupofAllAlt.png",
-        "QueensDecreeAlt.png", "PerandusSignetAlt.png", "AuxiumAlt.png", "dGlsbGF0ZUFsdCI7czoy",
-        // season 6
-        "PerandusBlazonAlt.png", "AurumvoraxAlt.png", "GoldwyrmAlt.png", "AmethystAlt.png", "DeathRushAlt.png", "RingUnique1.png", "MeginordsGirdleAlt.png",
-        "SidhebreathAlt.png", "MingsHeartAlt.png", "VoidBatteryAlt.png",
-        // season 7
-        "Empty-Socket2.png", "PrismaticEclipseAlt.png", "ThiefsTorment2.png", "Amulet5Unique2.png", "FurryheadofstarkonjaAlt.png", "Headhunter2.png",
-        "Belt6Unique2.png", "BlackgleamAlt.png", "ThousandribbonsAlt.png", "IjtzOjI6InNwIjtkOjAu",
-        // season 8
-        "TheThreeDragonsAlt.png", "ImmortalFleshAlt.png", "DreamFragmentsAlt2.png", "BereksGripAlt.png", "SaffellsFrameAlt.png", "BereksRespiteAlt.png",
-        "LifesprigAlt.png", "PillaroftheCagedGodAlt.png", "BereksPassAlt.png", "PrismaticRingAlt.png",
-        // season 9
-        "Fencoil.png", "TopazRing.png", "Cherufe2.png", "cy9CbG9ja0ZsYXNrMiI7", "BringerOfRain.png", "AgateAmuletUnique2.png",
-        // season 10
-        "StoneofLazhwarAlt.png", "SapphireRingAlt.png", "CybilsClawAlt.png", "DoedresDamningAlt.png", "AlphasHowlAlt.png", "dCI7czoyOiJzcCI7ZDow",
-        // season 11
-        "MalachaisArtificeAlt.png", "MokousEmbraceAlt.png", "RusticSashAlt2.png", "MaligarosVirtuosityAlt.png", "BinosKitchenKnifeAlt.png", "WarpedTimepieceAlt.png",
-        // emberwake season
-        "UngilsHarmonyAlt.png", "LightningColdTwoStoneRingAlt.png", "EdgeOfMadnessAlt.png", "RashkaldorsPatienceAlt.png", "RathpithGlobeAlt.png",
-        "EmberwakeAlt.png",
-        // bloodgrip season
-        "GoreFrenzyAlt.png", "BloodGloves.png", "BloodAmuletALT.png", "TheBloodThornALT.png", "BloodJewel.png", "BloodRIng.png",
-        // soulthirst season
-        "ThePrincessAlt.png", "EclipseStaff.png", "Perandus.png", "SoultakerAlt.png", "SoulthirstALT.png", "bHQiO3M6Mjoic3AiO2Q6",
-        // winterheart season
-        "AsphyxiasWrathRaceAlt.png", "SapphireRingRaceAlt.png", "TheWhisperingIceRaceAlt.png", "DyadianDawnRaceAlt.png", "CallOfTheBrotherhoodRaceAlt.png",
-        "WinterHeart.png",
-    };
-
+bool MTXFilter::Select(const ItemColumns &columns, FilterData *data, ItemColumns::Selection *selection) {
     if (!data->checked)
         return true;
+    ItemColumns::SelectFacet(columns.GetFacet(this, 0, [](const std::shared_ptr<Item> &item) {
+        return item->has_mtx();
+    }), selection);
+    return true;
+}
+
+// Evaluated by several threads during a search, function-local statics
+// aren't initialized in a thread-safe way by every compiler we support.
+static const std::vector<std::string> altart = {
+    // season 1
+    "RedBeak2.png", "Wanderlust2.png", "Ring2b.png", "Goldrim2.png", "FaceBreaker2.png", "Atzirismirror2.png",
+    // season 2
+    "KaruiWardAlt.png", "ShiverstingAlt.png", "QuillRainAlt.png", "OnyxAmuletAlt.png", "DeathsharpAlt.png", "CarnageHeartAlt.png",
+    "TabulaRasaAlt.png", "andvariusAlt.png", "AstramentisAlt.png",
+    // season 3
+    "BlackheartAlt.png", "SinTrekAlt.png", "ShavronnesPaceAlt.png", "Belt3Alt.png", "EyeofChayulaAlt.png", "SundanceAlt.png",
+    "ReapersPursuitAlt.png", "WindscreamAlt.png", "RainbowStrideAlt.png", "TarynsShiverAlt.png",
+    // season 4
+    "BrightbeakAlt.png", "RubyRingAlt.png", "TheSearingTouchAlt.png", "CloakofFlameAlt.png", "AtzirisFoibleAlt.png", "DivinariusAlt.png",
+    "HrimnorsResolveAlt.png", "CarcassJackAlt.png", "TheIgnomonAlt.png", "HeatShiverAlt.png",
+    // season 5
+    "KaomsSignAlt.png", "StormcloudAlt.png", "FairgravesTricorneAlt.png", "MoonstoneRingAlt.png", "GiftsfromAboveAlt.png", "LeHeupofAllAlt.png",
+    "QueensDecreeAlt.png", "PerandusSignetAlt.png", "AuxiumAlt.png", "dGlsbGF0ZUFsdCI7czoy",
+    // season 6
+    "PerandusBlazonAlt.png", "AurumvoraxAlt.png", "GoldwyrmAlt.png", "AmethystAlt.png", "DeathRushAlt.png", "RingUnique1.png", "MeginordsGirdleAlt.png",
+    "SidhebreathAlt.png", "MingsHeartAlt.png", "VoidBatteryAlt.png",
+    // season 7
+    "Empty-Socket2.png", "PrismaticEclipseAlt.png", "ThiefsTorment2.png", "Amulet5Unique2.png", "FurryheadofstarkonjaAlt.png", "Headhunter2.png",
+    "Belt6Unique2.png", "BlackgleamAlt.png", "ThousandribbonsAlt.png", "IjtzOjI6InNwIjtkOjAu",
+    // season 8
+    "TheThreeDragonsAlt.png", "ImmortalFleshAlt.png", "DreamFragmentsAlt2.png", "BereksGripAlt.png", "SaffellsFrameAlt.png", "BereksRespiteAlt.png",
+    "LifesprigAlt.png", "PillaroftheCagedGodAlt.png", "BereksPassAlt.png", "PrismaticRingAlt.png",
+    // season 9
+    "Fencoil.png", "TopazRing.png", "Cherufe2.png", "cy9CbG9ja0ZsYXNrMiI7", "BringerOfRain.png", "AgateAmuletUnique2.png",
+    // season 10
+    "StoneofLazhwarAlt.png", "SapphireRingAlt.png", "CybilsClawAlt.png", "DoedresDamningAlt.png", "AlphasHowlAlt.png", "dCI7czoyOiJzcCI7ZDow",
+    // season 11
+    "MalachaisArtificeAlt.png", "MokousEmbraceAlt.png", "RusticSashAlt2.png", "MaligarosVirtuosityAlt.png", "BinosKitchenKnifeAlt.png", "WarpedTimepieceAlt.png",
+    // emberwake season
+    "UngilsHarmonyAlt.png", "LightningColdTwoStoneRingAlt.png", "EdgeOfMadnessAlt.png", "RashkaldorsPatienceAlt.png", "RathpithGlobeAlt.png",
+    "EmberwakeAlt.png",
+    // bloodgrip season
+    "GoreFrenzyAlt.png", "BloodGloves.png", "BloodAmuletALT.png", "TheBloodThornALT.png", "BloodJewel.png", "BloodRIng.png",
+    // soulthirst season
+    "ThePrincessAlt.png", "EclipseStaff.png", "Perandus.png", "SoultakerAlt.png", "SoulthirstALT.png", "bHQiO3M6Mjoic3AiO2Q6",
+    // winterheart season
+    "AsphyxiasWrathRaceAlt.png", "SapphireRingRaceAlt.png", "TheWhisperingIceRaceAlt.png", "DyadianDawnRaceAlt.png", "CallOfTheBrotherhoodRaceAlt.png",
+    "WinterHeart.png",
+};
+
+bool AltartFilter::IsAltart(const Item &item) {
     for (auto &needle : altart)
-        if (item->icon().find(needle) != std::string::npos)
+        if (item.icon().find(needle) != std::string::npos)
             return true;
     return false;
 }
 
+bool AltartFilter::Matches(const std::shared_ptr<Item> &item, FilterData *data) {
+    return !data->checked || IsAltart(*item);
+}
+
+bool AltartFilter::Select(const ItemColumns &columns, FilterData *data, ItemColumns::Selection *selection) {
+    if (!data->checked)
+        return true;
+    ItemColumns::SelectFacet(columns.GetFacet(this, 0, [](const std::shared_ptr<Item> &item) {
+        return IsAltart(*item);
+    }), selection);
+    return true;
+}
+
 bool PricedFilter::Matches(const std::shared_ptr<Item> &item, FilterData *data) {
     if (!data->checked)
         return true;
     return bm_.Get(*item).IsActive();
 }
 
+bool PricedFilter::Narrows(const FilterData &before, const FilterData & /* after */) {
+    return !before.checked;
+}
+
 double ItemlevelFilter::GetValue(const std::shared_ptr<Item> &item) {
     return item->ilvl();
 }
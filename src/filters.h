@@ -23,6 +23,7 @@
 #include <memory>
 
 #include "item.h"
+#include "itemcolumns.h"
 #include "mainwindow.h"
 #include "porting.h"
 #include "ui_mainwindow.h"
@@ -36,6 +37,11 @@ class FilterData;
  * 1) FromForm: provided with a FilterData fill it with data from form
  * 2) ToForm: provided with a FilterData fill form with data from it
  * 3) Matches: check if an item matches the filter provided with FilterData
+ * 4) Select: optionally, do the same for all items at once using ItemColumns
+ * 5) Narrows: tell whether going from one FilterData to another can only drop
+ *    items, so that a search can re-check just its previous results
+ * 6) IsActive: tell whether the FilterData can drop any item at all, inactive
+ *    filters are skipped by searches
  */
 class Filter {
 public:
@@ -43,6 +49,15 @@ public:
     virtual void ToForm(FilterData *data) = 0;
     virtual void ResetForm() = 0;
     virtual bool Matches(const std::shared_ptr<Item> &item, FilterData *data) = 0;
+    // Deselects the items that don't match, returns false if the filter can only
+    // be checked with Matches.
+    virtual bool Select(const ItemColumns & /* columns */, FilterData * /* data */, ItemColumns::Selection * /* selection */) { return false; }
+    // True if every item matching after also matches before
+    virtual bool Narrows(const FilterData &before, const FilterData &after);
+    // False only if every item matches
+    virtual bool IsActive(const FilterData & /* data */) { return true; }
+    // True if Matches depends on buyouts rather than on the item alone
+    virtual bool UsesBuyouts() const { return false; }
     virtual ~Filter() {};
     std::unique_ptr<FilterData> CreateData();
 };
@@ -53,17 +68,31 @@ struct ModFilterData {
         min(min_),
         max(max_),
         min_filled(min_filled_),
-        max_filled(max_filled_)
+        max_filled(max_filled_),
+        mod_id(-1)
     {}
 
     std::string mod;
     double min, max;
     bool min_filled, max_filled;
+    // Id of the mod in mod_names, resolved by ModsFilter::FromForm
+    int mod_id;
+
+    bool operator==(const ModFilterData &other) const;
 };
 
+// True if the min/max bounds of after only exclude more than those of before,
+// works with anything that has min, max, min_filled and max_filled.
+template <typename T>
+bool BoundsNarrow(const T &before, const T &after) {
+    return (!before.min_filled || (after.min_filled && after.min >= before.min))
+        && (!before.max_filled || (after.max_filled && after.max <= before.max));
+}
+
 struct NamedGearFilterUIObj {
 	NamedGearFilterUIObj(const std::string &gearname_) : Gearname(gearname_) { }
 	std::string Gearname;
+	bool operator==(const NamedGearFilterUIObj &other) const { return Gearname == other.Gearname; }
 };
 /*
  * This is used to store filter data in Search,
@@ -74,8 +103,14 @@ public:
     FilterData(Filter *filter);
     Filter *filter () { return filter_; }
     bool Matches(const std::shared_ptr<Item> item);
+    bool Select(const ItemColumns &columns, ItemColumns::Selection *selection);
     void FromForm();
     void ToForm();
+    bool Narrows(const FilterData &before) const { return filter_->Narrows(before, *this); }
+    bool IsActive() const { return filter_->IsActive(*this); }
+    bool UsesBuyouts() const { return filter_->UsesBuyouts(); }
+    bool operator==(const FilterData &other) const;
+    bool operator!=(const FilterData &other) const { return !(*this == other); }
     // Various types of data for various filters
     // It's probably not a very elegant solution but it works.
     std::string text_query;
@@ -97,11 +132,25 @@ public:
     void ToForm(FilterData *data);
     void ResetForm();
     bool Matches(const std::shared_ptr<Item> &item, FilterData *data);
+    bool Select(const ItemColumns &columns, FilterData *data, ItemColumns::Selection *selection);
+    bool Narrows(const FilterData &before, const FilterData &after);
+    bool IsActive(const FilterData &data) { return !data.text_query.empty(); }
     void Initialize(QLayout *parent);
-private:
+protected:
+    // The text of the item the query is looked for in
+    virtual std::string Text(const Item &item) const { return item.PrettyName(); }
+
     QLineEdit *textbox_;
 };
 
+// Same as NameSearchFilter but looks for the query in the item's mods
+class ModTextFilter : public NameSearchFilter {
+public:
+    explicit ModTextFilter(QLayout *parent);
+protected:
+    std::string Text(const Item &item) const;
+};
+
 class MinMaxFilter : public Filter {
 public:
     MinMaxFilter(QLayout *parent, std::string property);
@@ -110,12 +159,16 @@ public:
     void ToForm(FilterData *data);
     void ResetForm();
     bool Matches(const std::shared_ptr<Item> &item, FilterData *data);
+    bool Select(const ItemColumns &columns, FilterData *data, ItemColumns::Selection *selection);
+    bool Narrows(const FilterData &before, const FilterData &after);
+    bool IsActive(const FilterData &data) { return data.min_filled || data.max_filled; }
     void Initialize(QLayout *parent);
 protected:
     virtual double GetValue(const std::shared_ptr<Item> &item) = 0;
     virtual bool IsValuePresent(const std::shared_ptr<Item> &item) = 0;
 
-    std::string property_, caption_;
+    InternedString property_;
+    std::string caption_;
 private:
     QLineEdit *textbox_min_, *textbox_max_;
 };
@@ -197,6 +250,8 @@ public:
     void ToForm(FilterData *data);
     void ResetForm();
     bool Matches(const std::shared_ptr<Item> &item, FilterData *data);
+    bool Narrows(const FilterData &before, const FilterData &after);
+    bool IsActive(const FilterData &data) { return data.r_filled || data.g_filled || data.b_filled; }
     void Initialize(QLayout *parent, const char* caption);
 protected:
     bool Check(int need_r, int need_g, int need_b, int got_r, int got_g, int got_b, int got_w);
@@ -216,6 +271,8 @@ public:
     void ToForm(FilterData *data);
     void ResetForm();
     bool Matches(const std::shared_ptr<Item> &item, FilterData *data);
+    bool Narrows(const FilterData &before, const FilterData &after);
+    bool IsActive(const FilterData &data) { return data.checked; }
     void Initialize(QLayout *parent);
 private:
     QCheckBox *checkbox_;
@@ -228,6 +285,7 @@ public:
     MTXFilter(QLayout *parent, std::string property, std::string caption):
         BooleanFilter(parent, property, caption) {}
     bool Matches(const std::shared_ptr<Item> &item, FilterData *data);
+    bool Select(const ItemColumns &columns, FilterData *data, ItemColumns::Selection *selection);
 };
 
 class AltartFilter : public BooleanFilter {
@@ -236,6 +294,9 @@ public:
         BooleanFilter(parent, property, caption) {}
     using BooleanFilter::BooleanFilter;
     bool Matches(const std::shared_ptr<Item> &item, FilterData *data);
+    bool Select(const ItemColumns &columns, FilterData *data, ItemColumns::Selection *selection);
+private:
+    static bool IsAltart(const Item &item);
 };
 
 class PricedFilter : public BooleanFilter {
@@ -245,6 +306,9 @@ public:
         bm_(bm)
     {}
     bool Matches(const std::shared_ptr<Item> &item, FilterData *data);
+    // Buyouts may have changed since before was applied
+    bool Narrows(const FilterData &before, const FilterData &after);
+    bool UsesBuyouts() const { return true; }
 private:
     const BuyoutManager &bm_;
 };
@@ -121,14 +121,37 @@ bool GearTypeFilter::Matches(const std::shared_ptr<Item> &item, FilterData *data
     for (auto &Gear : data->geartype_data) {
         if (Gear.Gearname.empty())
             return true;
-        for (auto props : item->text_properties()){
-            if (props.name.find(Gear.Gearname) != std::string::npos)
-                return true;
-        }
-        return false;
+        return HasGearType(*item, Gear.Gearname);
     }
     return true;
 }
+
+// Only the first gear type counts, same as in Matches
+bool GearTypeFilter::Select(const ItemColumns &columns, FilterData *data, ItemColumns::Selection *selection) {
+    if (data->geartype_data.empty() || data->geartype_data.front().Gearname.empty())
+        return true;
+    std::string name = data->geartype_data.front().Gearname;
+    // Text typed into the box that isn't a known gear type isn't worth keeping a facet for
+    int id = gear_names.Find(name);
+    if (id < 0)
+        return false;
+    ItemColumns::SelectFacet(columns.GetFacet(this, id, [name](const std::shared_ptr<Item> &item) {
+        return HasGearType(*item, name);
+    }), selection);
+    return true;
+}
+
+bool GearTypeFilter::IsActive(const FilterData &data) {
+    return !data.geartype_data.empty() && !data.geartype_data.front().Gearname.empty();
+}
+
+bool GearTypeFilter::HasGearType(const Item &item, const std::string &name) {
+    for (auto &props : item.text_properties()) {
+        if (props.name.str().find(name) != std::string::npos)
+            return true;
+    }
+    return false;
+}
 #pragma endregion
 
 
@@ -85,7 +85,10 @@ public:
     void ToForm(FilterData *data);
     void ResetForm();
     bool Matches(const std::shared_ptr<Item> &item, FilterData *data);
+    bool Select(const ItemColumns &columns, FilterData *data, ItemColumns::Selection *selection);
+    bool IsActive(const FilterData &data);
 private:
+    static bool HasGearType(const Item &item, const std::string &name);
     void Clear();
     void ClearSignalMapper();
     void ClearLayout();
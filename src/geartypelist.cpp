@@ -32,6 +32,7 @@
 
 // Actual list of mods is computed at runtime
 QStringList gear_string_list;
+ModNames gear_names;
 
 // These are just summed, and the mod named as the first element of a vector is generated with value equaling the sum.
 // Both implicit and explicit fields are considered.
@@ -82,6 +83,7 @@ void InitGearlist() {
 //constructor:
 SumGearGenerator::SumGearGenerator(const std::string &name, const std::vector<std::string> &sum) :
     name_(name),
+    id_(gear_names.Add(name)),
     matches_(sum)
 {}
 
@@ -115,6 +117,6 @@ void SumGearGenerator::Generate(const rapidjson::Value &json, GearTable *output)
     }
 
 	if (gear_present)
-        (*output)[name_] = sum;
+        output->Add(id_, sum);
 */
 }
@@ -26,8 +26,10 @@
 #include <QStringList>
 #include "rapidjson/document.h"
 
+#include "modtable.h"
+
 class Item;
-typedef std::unordered_map<std::string, double> GearTable;
+typedef ModTable GearTable;
 
 // This generates regular expressions for mods and does other setup, should be called when the app starts, perhaps in main()
 // Maybe this is not needed and constexpr could do the trick, but VS doesn't support it right now.
@@ -41,8 +43,10 @@ private:
     bool Match(const char *gear, double *output);
 
     std::string name_;
+    int id_;
     std::vector<std::string> matches_;
 };
 
 extern QStringList gear_string_list;
+extern ModNames gear_names;
 extern std::vector<std::unique_ptr<SumGearGenerator>> gear_generators;
@@ -0,0 +1,68 @@
+/*
+    Copyright 2016 Ilya Zhuravlev
+
+    This file is part of Acquisition.
+
+    Acquisition is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Acquisition is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Acquisition.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "internedstring.h"
+
+#include <mutex>
+#include <unordered_set>
+
+namespace {
+
+class StringPool {
+public:
+    const std::string *Intern(const std::string &value) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        // Elements of an unordered_set don't move when it grows
+        return &*strings_.insert(value).first;
+    }
+private:
+    std::mutex mutex_;
+    std::unordered_set<std::string> strings_;
+};
+
+StringPool &Pool() {
+    static StringPool pool;
+    return pool;
+}
+
+const std::string *Empty() {
+    static const std::string *empty = Pool().Intern(std::string());
+    return empty;
+}
+
+// Makes sure the pool is created before any other thread can get to it
+const std::string *const kEmpty = Empty();
+
+}
+
+InternedString::InternedString() :
+    value_(Empty())
+{}
+
+InternedString::InternedString(const std::string &value) :
+    value_(value.empty() ? Empty() : Pool().Intern(value))
+{}
+
+InternedString::InternedString(const char *value) :
+    InternedString(std::string(value))
+{}
+
+InternedString::InternedString(const char *data, size_t size) :
+    InternedString(std::string(data, size))
+{}
@@ -0,0 +1,68 @@
+/*
+    Copyright 2016 Ilya Zhuravlev
+
+    This file is part of Acquisition.
+
+    Acquisition is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Acquisition is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Acquisition.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+
+/*
+ * InternedString is a handle to a string kept in a global pool, one copy per
+ * distinct value.
+ *
+ * Items repeat the same strings over and over: property names, base types, icons,
+ * tab labels. Storing them as handles saves the copies, and since equal strings are
+ * the same object, comparing and hashing handles is comparing and hashing pointers.
+ * Creating a handle looks the value up in the pool, so strings that are compared
+ * often (e.g. the name of a property used by a filter) should be kept as
+ * InternedString rather than converted on every use.
+ *
+ * The pool is shared by all threads, locked on every lookup, and never shrinks:
+ * only intern strings with few distinct values. Mod lines, for instance, are
+ * mostly unique to their item and stay plain strings.
+ */
+class InternedString {
+public:
+    InternedString();
+    InternedString(const std::string &value);
+    InternedString(const char *value);
+    InternedString(const char *data, size_t size);
+
+    const std::string &str() const { return *value_; }
+    operator const std::string &() const { return *value_; }
+    const char *c_str() const { return value_->c_str(); }
+    size_t size() const { return value_->size(); }
+    bool empty() const { return value_->empty(); }
+
+    bool operator==(const InternedString &other) const { return value_ == other.value_; }
+    bool operator!=(const InternedString &other) const { return value_ != other.value_; }
+    // Same order as std::string so that sorted containers don't change
+    bool operator<(const InternedString &other) const { return value_ != other.value_ && *value_ < *other.value_; }
+    size_t hash() const { return std::hash<const std::string*>()(value_); }
+private:
+    const std::string *value_;
+};
+
+namespace std {
+template <>
+struct hash<InternedString> {
+    size_t operator()(const InternedString &value) const { return value.hash(); }
+};
+}
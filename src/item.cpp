@@ -19,9 +19,12 @@
 
 #include "item.h"
 
+#include <cctype>
 #include <utility>
 #include <QString>
 #include "rapidjson/document.h"
+#include "rapidjson/stringbuffer.h"
+#include "rapidjson/writer.h"
 
 #include "modlist.h"
 #include "util.h"
@@ -32,6 +35,13 @@ const std::vector<std::string> ITEM_MOD_TYPES = {
     "implicitMods", "enchantMods", "explicitMods", "craftedMods", "cosmeticMods"
 };
 
+static const InternedString kLevel("Level");
+static const InternedString kMapLevel("Map Level");
+static const InternedString kElementalDamage("Elemental Damage");
+static const InternedString kPhysicalDamage("Physical Damage");
+static const InternedString kAttacksPerSecond("Attacks per Second");
+static const InternedString kStackSize("Stack Size");
+
 static std::string item_unique_properties(const rapidjson::Value &json, const std::string &name) {
     const char *name_p = name.c_str();
     if (!json.HasMember(name_p))
@@ -54,16 +64,37 @@ static std::string fixup_name(const std::string &name) {
     return name;
 }
 
+Item::Item() :
+    corrupted_(false),
+    identified_(false),
+    w_(0),
+    h_(0),
+    frameType_(0),
+    sockets_cnt_(0),
+    links_cnt_(0),
+    sockets_({ 0, 0, 0, 0 }),
+    json_offset_(0),
+    json_size_(0),
+    count_(1),
+    has_mtx_(false),
+    ilvl_(0)
+{
+    for (auto &mod_type : ITEM_MOD_TYPES)
+        text_mods_[mod_type] = ItemMods();
+}
+
 Item::Item(const std::string &name, const ItemLocation &location) :
     name_(name),
     location_(location),
-    hash_(Util::Md5(name)) // Unique enough for tests
+    hash_(Util::Md5(name)), // Unique enough for tests
+    json_offset_(0),
+    json_size_(0)
 {}
 
 Item::Item(const rapidjson::Value &json) :
-    name_(fixup_name(json["name"].GetString())),
+    name_(json["name"].GetString()),
     location_(ItemLocation(json)),
-    typeLine_(fixup_name(json["typeLine"].GetString())),
+    typeLine_(json["typeLine"].GetString()),
     corrupted_(json["corrupted"].GetBool()),
     identified_(json["identified"].GetBool()),
     w_(json["w"].GetInt()),
@@ -73,12 +104,26 @@ Item::Item(const rapidjson::Value &json) :
     sockets_cnt_(0),
     links_cnt_(0),
     sockets_({ 0, 0, 0, 0 }),
-    json_(Util::RapidjsonSerialize(json)),
+    json_offset_(0),
+    json_size_(0),
     has_mtx_(false),
     ilvl_(0)
 {
+    // Location fields are kept in location_ and only written out with the rest in json()
+    rapidjson::StringBuffer buffer;
+    rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+    writer.StartObject();
+    for (auto it = json.MemberBegin(); it != json.MemberEnd(); ++it) {
+        if (ItemLocation::IsLocationField(it->name.GetString()))
+            continue;
+        writer.Key(it->name.GetString(), it->name.GetStringLength());
+        it->value.Accept(writer);
+    }
+    json_source_ = QByteArray(buffer.GetString(), buffer.GetSize());
+    json_size_ = json_source_.size();
+
     for (auto &mod_type : ITEM_MOD_TYPES) {
-        text_mods_[mod_type] = std::vector<std::string>();
+        text_mods_[mod_type] = ItemMods();
         if (json.HasMember(mod_type.c_str())) {
             auto &mods = text_mods_[mod_type];
             for (auto &mod : json[mod_type.c_str()])
@@ -95,22 +140,9 @@ Item::Item(const rapidjson::Value &json) :
     }
 
     if (json.HasMember("properties")) {
-        for (auto prop_it = json["properties"].Begin(); prop_it != json["properties"].End(); ++prop_it) {
-            auto &prop = *prop_it;
-            std::string name = prop["name"].GetString();
-            if (name == "Map Level")
-                name = "Level";
-            if (name == "Elemental Damage") {
-                for (auto value_it = prop["values"].Begin(); value_it != prop["values"].End(); ++value_it)
-                    elemental_damage_.push_back(std::make_pair((*value_it)[0].GetString(), (*value_it)[1].GetInt()));
-            }
-            else {
-                if (prop["values"].Size())
-                    properties_[name] = prop["values"][0][0].GetString();
-            }
-
+        for (auto &prop : json["properties"]) {
             ItemProperty property;
-            property.name = name;
+            property.name = prop["name"].GetString();
             property.display_mode = prop["displayMode"].GetInt();
             for (auto &value : prop["values"]) {
                 ItemPropertyValue v;
@@ -118,81 +150,144 @@ Item::Item(const rapidjson::Value &json) :
                 v.type = value[1].GetInt();
                 property.values.push_back(v);
             }
-            text_properties_.push_back(property);
+            AddProperty(property);
         }
     }
 
     if (json.HasMember("requirements")) {
         for (auto &req : json["requirements"]) {
-            std::string name = req["name"].GetString();
-            std::string value = req["values"][0][0].GetString();
-            requirements_[name] = std::atoi(value.c_str());
             ItemPropertyValue v;
-            v.str = value;
+            v.str = req["values"][0][0].GetString();
             v.type = req["values"][0][1].GetInt();
-            text_requirements_.push_back({ name, v });
+            AddRequirement(req["name"].GetString(), v);
         }
     }
 
     if (json.HasMember("sockets")) {
-        ItemSocketGroup current_group = { 0, 0, 0, 0 };
-        sockets_cnt_ = json["sockets"].Size();
-        int counter = 0, prev_group = -1;
         for (auto &socket : json["sockets"]) {
             ItemSocket current_socket = { static_cast<unsigned char>(socket["group"].GetInt()), socket["attr"].GetString()[0] };
             text_sockets_.push_back(current_socket);
-            if (prev_group != current_socket.group) {
-                counter = 0;
-                socket_groups_.push_back(current_group);
-                current_group = { 0, 0, 0, 0 };
-            }
-            prev_group = current_socket.group;
-            ++counter;
-            links_cnt_ = std::max(links_cnt_, counter);
-            switch (current_socket.attr) {
-            case 'S':
-                sockets_.r++;
-                current_group.r++;
-                break;
-            case 'D':
-                sockets_.g++;
-                current_group.g++;
-                break;
-            case 'I':
-                sockets_.b++;
-                current_group.b++;
-                break;
-            case 'G':
-                sockets_.w++;
-                current_group.w++;
-                break;
-            }
         }
-        socket_groups_.push_back(current_group);
     }
 
-    CalculateHash(json);
+    has_mtx_ = json.HasMember("cosmeticMods");
+
+    if (json.HasMember("ilvl"))
+        ilvl_ = json["ilvl"].GetInt();
+
+    Finish(item_unique_properties(json, "properties"), item_unique_properties(json, "additionalProperties"), json.HasMember("sockets"));
+}
+
+std::string Item::json() const {
+    std::string output;
+    AppendJson(&output);
+    return output;
+}
+
+void Item::AppendJson(std::string *output) const {
+    rapidjson::StringBuffer buffer;
+    rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+    writer.StartObject();
+    location_.ToItemJson(&writer);
+    writer.EndObject();
+    const char *location = buffer.GetString();
+
+    if (json_size_ == 0) {
+        output->append(location);
+        return;
+    }
+    const char *json = json_source_.constData() + json_offset_;
+    output->append(json, json_size_);
+    int last = json_size_ - 1;
+    while (last > 0 && isspace(static_cast<unsigned char>(json[last])))
+        --last;
+    if (json[last] != '{')
+        output->push_back(',');
+    // skip the opening brace, the closing one is what the item's json lacks
+    output->append(location + 1);
+}
+
+void Item::AddProperty(ItemProperty property) {
+    if (property.name == kMapLevel)
+        property.name = kLevel;
+    if (property.name == kElementalDamage) {
+        for (auto &value : property.values)
+            elemental_damage_.push_back(std::make_pair(value.str, value.type));
+    }
+    else {
+        if (property.values.size())
+            properties_[property.name] = property.values[0].str;
+    }
+    text_properties_.push_back(property);
+}
+
+void Item::AddRequirement(const std::string &name, const ItemPropertyValue &value) {
+    requirements_[name] = std::atoi(value.str.c_str());
+    text_requirements_.push_back({ name, value });
+}
+
+void Item::Finish(const std::string &unique_properties, const std::string &unique_additional_properties, bool has_sockets) {
+    std::string raw_name = name_;
+    std::string raw_type_line = typeLine_;
+    name_ = fixup_name(raw_name);
+    typeLine_ = fixup_name(raw_type_line);
+
+    if (has_sockets)
+        CalculateSockets();
+
+    CalculateHash(raw_name, raw_type_line, unique_properties, unique_additional_properties);
 
     count_ = 1;
-    if (properties_.find("Stack Size") != properties_.end()) {
-        std::string size = properties_["Stack Size"];
+    auto stack_size = properties_.find(kStackSize);
+    if (stack_size != properties_.end()) {
+        std::string size = stack_size->second;
         if (size.find("/") != std::string::npos) {
             size = size.substr(0, size.find("/"));
             count_ = std::stoi(size);
         }
     }
 
-    has_mtx_ = json.HasMember("cosmeticMods");
-
-    if (json.HasMember("ilvl"))
-        ilvl_ = json["ilvl"].GetInt();
+    GenerateMods();
+}
 
-    GenerateMods(json);
+void Item::CalculateSockets() {
+    ItemSocketGroup current_group = { 0, 0, 0, 0 };
+    sockets_cnt_ = text_sockets_.size();
+    int counter = 0, prev_group = -1;
+    for (auto &current_socket : text_sockets_) {
+        if (prev_group != current_socket.group) {
+            counter = 0;
+            socket_groups_.push_back(current_group);
+            current_group = { 0, 0, 0, 0 };
+        }
+        prev_group = current_socket.group;
+        ++counter;
+        links_cnt_ = std::max(links_cnt_, counter);
+        switch (current_socket.attr) {
+        case 'S':
+            sockets_.r++;
+            current_group.r++;
+            break;
+        case 'D':
+            sockets_.g++;
+            current_group.g++;
+            break;
+        case 'I':
+            sockets_.b++;
+            current_group.b++;
+            break;
+        case 'G':
+            sockets_.w++;
+            current_group.w++;
+            break;
+        }
+    }
+    socket_groups_.push_back(current_group);
 }
 
 std::string Item::PrettyName() const {
     if (!name_.empty())
-        return name_ + " " + typeLine_;
+        return name_ + " " + typeLine_.str();
     return typeLine_;
 }
 
@@ -201,49 +296,47 @@ double Item::DPS() const {
 }
 
 double Item::pDPS() const {
-    if (!properties_.count("Physical Damage") || !properties_.count("Attacks per Second"))
+    if (!properties_.count(kPhysicalDamage) || !properties_.count(kAttacksPerSecond))
         return 0;
-    double aps = std::stod(properties_.at("Attacks per Second"));
-    std::string pd = properties_.at("Physical Damage");
+    double aps = std::stod(properties_.at(kAttacksPerSecond));
+    std::string pd = properties_.at(kPhysicalDamage);
 
     return aps * Util::AverageDamage(pd);
 }
 
 double Item::eDPS() const {
-    if (elemental_damage_.empty() || !properties_.count("Attacks per Second"))
+    if (elemental_damage_.empty() || !properties_.count(kAttacksPerSecond))
         return 0;
     double damage = 0;
     for (auto &x : elemental_damage_)
         damage += Util::AverageDamage(x.first);
-    double aps = std::stod(properties_.at("Attacks per Second"));
+    double aps = std::stod(properties_.at(kAttacksPerSecond));
     return aps * damage;
 }
 
-void Item::GenerateMods(const rapidjson::Value &json) {
+void Item::GenerateMods() {
     for (auto &generator : mod_generators)
-        generator->Generate(json, &mod_table_);
+        generator->Generate(*this, &mod_table_);
 }
 
-void Item::CalculateHash(const rapidjson::Value &json) {
-    std::string unique_old(name_ + "~" + typeLine_ + "~");
-    std::string unique_new(std::string(json["name"].GetString()) + "~" + json["typeLine"].GetString() + "~");
+void Item::CalculateHash(const std::string &raw_name, const std::string &raw_type_line,
+        const std::string &unique_properties, const std::string &unique_additional_properties) {
+    std::string unique_old(name_ + "~" + typeLine_.str() + "~");
+    std::string unique_new(raw_name + "~" + raw_type_line + "~");
 
     std::string unique_common;
 
-    if (json.HasMember("explicitMods"))
-        for (auto &mod : json["explicitMods"])
-            unique_common += std::string(mod.GetString()) + "~";
+    for (auto &mod : text_mods_.at("explicitMods"))
+        unique_common += mod + "~";
 
-    if (json.HasMember("implicitMods"))
-        for (auto &mod : json["implicitMods"])
-            unique_common += std::string(mod.GetString()) + "~";
+    for (auto &mod : text_mods_.at("implicitMods"))
+        unique_common += mod + "~";
 
-    unique_common += item_unique_properties(json, "properties") + "~";
-    unique_common += item_unique_properties(json, "additionalProperties") + "~";
+    unique_common += unique_properties + "~";
+    unique_common += unique_additional_properties + "~";
 
-    if (json.HasMember("sockets"))
-        for (auto &socket : json["sockets"])
-            unique_common += std::to_string(socket["group"].GetInt()) + "~" + socket["attr"].GetString() + "~";
+    for (auto &socket : text_sockets_)
+        unique_common += std::to_string(socket.group) + "~" + socket.attr + "~";
 
     unique_old += unique_common;
     unique_new += unique_common;
@@ -24,10 +24,13 @@
 #include <string>
 #include <unordered_map>
 #include <vector>
+#include <QByteArray>
 #include "rapidjson/document.h"
 
+#include "internedstring.h"
 #include "itemconstants.h"
 #include "itemlocation.h"
+#include "modtable.h"
 
 extern const std::vector<std::string> ITEM_MOD_TYPES;
 
@@ -41,7 +44,7 @@ struct ItemPropertyValue {
 };
 
 struct ItemProperty {
-    std::string name;
+    InternedString name;
     std::vector<ItemPropertyValue> values;
     int display_mode;
 };
@@ -56,16 +59,18 @@ struct ItemSocket {
     char attr;
 };
 
+// Mod lines are mostly unique, they aren't worth interning
 typedef std::vector<std::string> ItemMods;
-typedef std::unordered_map<std::string, double> ModTable;
-typedef std::unordered_map<std::string, double> GearTable;
+// Property values by name
+typedef std::unordered_map<InternedString, std::string> ItemProperties;
+typedef ModTable GearTable;
 
 class Item {
 public:
     explicit Item(const rapidjson::Value &json);
     Item(const std::string &name, const ItemLocation &location); // used by tests
     std::string name() const { return name_; }
-    std::string typeLine() const { return typeLine_; }
+    const std::string &typeLine() const { return typeLine_; }
     std::string PrettyName() const;
     bool corrupted() const { return corrupted_; }
     bool identified() const { return identified_; }
@@ -73,12 +78,13 @@ public:
     int h() const { return h_; }
     int frameType() const { return frameType_; }
     const std::string &icon() const { return icon_; }
-    const std::map<std::string, std::string> &properties() const { return properties_; }
+    const ItemProperties &properties() const { return properties_; }
     const std::vector<ItemProperty> &text_properties() const { return text_properties_; }
     const std::vector<ItemRequirement> &text_requirements() const { return text_requirements_; }
     const std::map<std::string, ItemMods> &text_mods() const { return text_mods_; }
     const std::vector<ItemSocket> &text_sockets() const { return text_sockets_; }
     const std::string &hash() const { return hash_; }
+    const std::string &uid() const { return uid_; }
     const std::string &old_hash() const { return old_hash_; }
     const std::vector<std::pair<std::string, int>> &elemental_damage() const { return elemental_damage_; }
     const std::map<std::string, int> &requirements() const { return requirements_; }
@@ -90,7 +96,13 @@ public:
     const ItemSocketGroup &sockets() const { return sockets_; }
     const std::vector<ItemSocketGroup> &socket_groups() const { return socket_groups_; }
     const ItemLocation &location() const { return location_; }
-    const std::string& json() { return json_; };
+    // The item's json with its location fields, as it's stored
+    std::string json() const;
+    // Same as above, appended to output
+    void AppendJson(std::string *output) const;
+    // The item's json as received, without the closing brace and the location fields.
+    // Doesn't copy anything, so it's only valid as long as the item is alive.
+    QByteArray raw_json() const { return QByteArray::fromRawData(json_source_.constData() + json_offset_, json_size_); }
     const std::string& note() const { return note_; };
     int count() const { return count_; };
     bool has_mtx() const { return has_mtx_; }
@@ -100,20 +112,32 @@ public:
     bool operator<(const Item &other) const;
 
 private:
+    friend class ItemArena;
+    friend class ItemParser;
+    friend class ItemSnapshotAccess;
+    // Used by ItemParser and ItemSnapshot, which fill the fields themselves
+    Item();
+    void AddProperty(ItemProperty property);
+    void AddRequirement(const std::string &name, const ItemPropertyValue &value);
+    // Derives the rest of the fields from the parsed ones. name_ and typeLine_ are
+    // expected to be exactly as in json, unique_* are the properties as used in hashes.
+    void Finish(const std::string &unique_properties, const std::string &unique_additional_properties, bool has_sockets);
+    void CalculateSockets();
     // The point of GenerateMods is to create combined (e.g. implicit+explicit) poe.trade-like mod map to be searched by mod filter.
     // For now it only does that for a small chosen subset of mods (think "popular" + "pseudo" sections at poe.trade)
-    void GenerateMods(const rapidjson::Value &json);
-    void CalculateHash(const rapidjson::Value &json);
+    void GenerateMods();
+    void CalculateHash(const std::string &raw_name, const std::string &raw_type_line,
+        const std::string &unique_properties, const std::string &unique_additional_properties);
 
     std::string name_;
     ItemLocation location_;
-    std::string typeLine_;
+    InternedString typeLine_;
     bool corrupted_;
     bool identified_;
     int w_, h_;
     int frameType_;
-    std::string icon_;
-    std::map<std::string, std::string> properties_;
+    InternedString icon_;
+    ItemProperties properties_;
     std::string old_hash_, hash_;
     // vector of pairs [damage, type]
     std::vector<std::pair<std::string, int>> elemental_damage_;
@@ -121,7 +145,10 @@ private:
     ItemSocketGroup sockets_;
     std::vector<ItemSocketGroup> socket_groups_;
     std::map<std::string, int> requirements_;
-    std::string json_;
+    // The buffer the item was parsed from (usually the whole reply it came in) and
+    // the range of it occupied by the item, see raw_json.
+    QByteArray json_source_;
+    int json_offset_, json_size_;
     int count_;
     bool has_mtx_;
     int ilvl_;
@@ -136,3 +163,16 @@ private:
 };
 
 typedef std::vector<std::shared_ptr<Item>> Items;
+
+// What happened to the items of a single location (stash tab or character) during a refresh
+struct TabChanges {
+    // all items of the location after the refresh
+    Items items;
+    Items added;
+    Items removed;
+    // pairs of [before, after]
+    std::vector<std::pair<std::shared_ptr<Item>, std::shared_ptr<Item>>> modified;
+};
+
+// Only locations that actually changed are present
+typedef std::map<ItemLocation, TabChanges> ItemsChangeSet;
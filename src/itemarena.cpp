@@ -0,0 +1,82 @@
+/*
+    Copyright 2016 Ilya Zhuravlev
+
+    This file is part of Acquisition.
+
+    Acquisition is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Acquisition is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Acquisition.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "itemarena.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <new>
+
+#include "item.h"
+
+// Blocks start small so that small tabs don't waste much, and grow for the big ones
+const size_t kFirstBlockSize = 8 * 1024;
+const size_t kMaxBlockSize = 256 * 1024;
+
+namespace {
+
+// Only destroys the item, its memory belongs to the arena
+class ItemArenaDeleter {
+public:
+    explicit ItemArenaDeleter(const std::shared_ptr<ItemArena> &arena) : arena_(arena) {}
+    void operator()(Item *item) const { item->~Item(); }
+private:
+    std::shared_ptr<ItemArena> arena_;
+};
+
+}
+
+std::atomic<int> ItemArena::live_count_(0);
+
+ItemArena::ItemArena() :
+    current_(nullptr),
+    left_(0),
+    next_block_size_(kFirstBlockSize)
+{
+    ++live_count_;
+}
+
+ItemArena::~ItemArena() {
+    for (auto block : blocks_)
+        ::operator delete(block);
+    --live_count_;
+}
+
+void *ItemArena::Allocate(size_t size, size_t alignment) {
+    size_t padding = (alignment - reinterpret_cast<uintptr_t>(current_) % alignment) % alignment;
+    if (current_ == nullptr || padding + size > left_) {
+        size_t block_size = std::max(next_block_size_, size + alignment);
+        next_block_size_ = std::min(next_block_size_ * 2, kMaxBlockSize);
+        current_ = static_cast<char*>(::operator new(block_size));
+        blocks_.push_back(current_);
+        left_ = block_size;
+        padding = (alignment - reinterpret_cast<uintptr_t>(current_) % alignment) % alignment;
+    }
+    char *result = current_ + padding;
+    current_ = result + size;
+    left_ -= padding + size;
+    return result;
+}
+
+std::shared_ptr<Item> ItemArena::NewItem(const std::shared_ptr<ItemArena> &arena) {
+    void *memory = arena->Allocate(sizeof(Item), std::alignment_of<Item>::value);
+    Item *item = new (memory) Item();
+    // The control block is allocated from the arena too
+    return std::shared_ptr<Item>(item, ItemArenaDeleter(arena), ItemArenaAllocator<Item>(arena));
+}
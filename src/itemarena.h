@@ -0,0 +1,91 @@
+/*
+    Copyright 2016 Ilya Zhuravlev
+
+    This file is part of Acquisition.
+
+    Acquisition is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Acquisition is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Acquisition.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+class Item;
+
+/*
+ * ItemArena hands out memory for the items built from a single reply (or snapshot)
+ * and the shared_ptr control blocks that own them.
+ *
+ * A stash is tens of thousands of items, allocating and freeing each of them on its own
+ * is slow and fragments the heap. The arena takes memory in large blocks and never
+ * frees anything separately: the blocks go away at once when the last item allocated
+ * from them is destroyed.
+ *
+ * A single surviving item keeps its whole arena alive, so an arena only ever holds the
+ * items of one location, which are replaced all together by a refresh (see
+ * ItemsManagerWorker::DiffItems).
+ *
+ * An arena is filled by one thread at a time; items may be released from any thread.
+ */
+class ItemArena {
+public:
+    ItemArena();
+    ~ItemArena();
+    void *Allocate(size_t size, size_t alignment);
+    // Creates an empty item in the arena, it keeps the arena alive
+    static std::shared_ptr<Item> NewItem(const std::shared_ptr<ItemArena> &arena);
+    // Number of arenas alive
+    static int live_count() { return live_count_; }
+private:
+    ItemArena(const ItemArena&) = delete;
+    ItemArena &operator=(const ItemArena&) = delete;
+
+    std::vector<char*> blocks_;
+    char *current_;
+    size_t left_;
+    size_t next_block_size_;
+
+    static std::atomic<int> live_count_;
+};
+
+// Standard allocator over an ItemArena, copies share (and keep alive) the same arena
+template <class T>
+class ItemArenaAllocator {
+public:
+    typedef T value_type;
+    template <class U> struct rebind { typedef ItemArenaAllocator<U> other; };
+
+    explicit ItemArenaAllocator(const std::shared_ptr<ItemArena> &arena) : arena_(arena) {}
+    template <class U>
+    ItemArenaAllocator(const ItemArenaAllocator<U> &other) : arena_(other.arena()) {}
+
+    T *allocate(size_t n) {
+        return static_cast<T*>(arena_->Allocate(n * sizeof(T), std::alignment_of<T>::value));
+    }
+    // Everything is freed along with the arena
+    void deallocate(T*, size_t) {}
+
+    const std::shared_ptr<ItemArena> &arena() const { return arena_; }
+private:
+    std::shared_ptr<ItemArena> arena_;
+};
+
+template <class T, class U>
+bool operator==(const ItemArenaAllocator<T> &a, const ItemArenaAllocator<U> &b) { return a.arena() == b.arena(); }
+template <class T, class U>
+bool operator!=(const ItemArenaAllocator<T> &a, const ItemArenaAllocator<U> &b) { return !(a == b); }
@@ -0,0 +1,178 @@
+/*
+    Copyright 2016 Ilya Zhuravlev
+
+    This file is part of Acquisition.
+
+    Acquisition is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Acquisition is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Acquisition.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "itemcolumns.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "porting.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define ACQUISITION_SSE2
+#endif
+
+ItemColumns::ItemColumns(const Items &items) :
+    items_(items)
+{}
+
+void ItemColumns::Reset() {
+    columns_.clear();
+    sorted_.clear();
+    facets_.clear();
+    indexes_.clear();
+    ++generation_;
+}
+
+const ItemColumns::Column &ItemColumns::Get(const void *owner, int index, const ValueFunction &value) const {
+    auto key = std::make_pair(owner, index);
+    auto it = columns_.find(key);
+    if (it != columns_.end())
+        return it->second;
+
+    Column &column = columns_[key];
+    column.reserve(items_.size());
+    for (auto &item : items_)
+        column.push_back(value(item));
+    return column;
+}
+
+const ItemColumns::SortedColumn &ItemColumns::GetSorted(const void *owner, int index, const ValueFunction &value) const {
+    auto key = std::make_pair(owner, index);
+    auto it = sorted_.find(key);
+    if (it != sorted_.end())
+        return it->second;
+
+    const Column &column = Get(owner, index, value);
+    std::vector<std::pair<double, uint32_t>> entries;
+    for (size_t i = 0; i < column.size(); ++i)
+        if (!std::isnan(column[i]))
+            entries.push_back(std::make_pair(column[i], static_cast<uint32_t>(i)));
+    std::sort(entries.begin(), entries.end());
+
+    SortedColumn &sorted = sorted_[key];
+    sorted.values.reserve(entries.size());
+    sorted.ids.reserve(entries.size());
+    for (auto &entry : entries) {
+        sorted.values.push_back(entry.first);
+        sorted.ids.push_back(entry.second);
+    }
+    return sorted;
+}
+
+const ItemColumns::Selection &ItemColumns::GetFacet(const void *owner, int index, const Predicate &predicate) const {
+    auto key = std::make_pair(owner, index);
+    auto it = facets_.find(key);
+    if (it != facets_.end())
+        return it->second;
+
+    Selection &facet = facets_[key];
+    facet.reserve(items_.size());
+    for (auto &item : items_)
+        facet.push_back(predicate(item) ? 1 : 0);
+    return facet;
+}
+
+bool ItemColumns::SelectText(const void *owner, const TextFunction &text, const std::string &query, Selection *selection) const {
+    auto &index = indexes_[owner];
+    if (!index) {
+        index = std::make_unique<TrigramIndex>();
+        for (size_t i = 0; i < items_.size(); ++i)
+            index->Add(i, text(items_[i]));
+    }
+
+    std::string needle = TrigramIndex::Lowercase(query);
+    auto contains = [&](size_t i) {
+        return TrigramIndex::Lowercase(text(items_[i])).find(needle) != std::string::npos;
+    };
+    std::vector<uint32_t> candidates;
+    if (!index->Candidates(needle, &candidates))
+        return false;
+    // Only candidates that are still selected need to be checked
+    Ids found;
+    for (auto i : candidates)
+        if (i < selection->size() && (*selection)[i] && contains(i))
+            found.push_back(i);
+    SelectIds(found, selection);
+    return true;
+}
+
+double ItemColumns::Missing() {
+    return std::numeric_limits<double>::quiet_NaN();
+}
+
+void ItemColumns::SelectRange(const Column &column, double min, double max, Selection *selection) {
+    const double *values = column.data();
+    unsigned char *selected = selection->data();
+    size_t size = std::min(column.size(), selection->size());
+    size_t i = 0;
+#ifdef ACQUISITION_SSE2
+    // Compilers won't vectorize the scalar loop below on their own because the
+    // comparisons could raise floating point exceptions. Ordered compares are
+    // false for NaN, so missing values fail both of them here as well.
+    __m128d low = _mm_set1_pd(min), high = _mm_set1_pd(max);
+    for (; i + 4 <= size; i += 4) {
+        __m128d a = _mm_loadu_pd(values + i);
+        __m128d b = _mm_loadu_pd(values + i + 2);
+        int mask = _mm_movemask_pd(_mm_and_pd(_mm_cmpge_pd(a, low), _mm_cmple_pd(a, high)))
+            | _mm_movemask_pd(_mm_and_pd(_mm_cmpge_pd(b, low), _mm_cmple_pd(b, high))) << 2;
+        selected[i] &= mask & 1;
+        selected[i + 1] &= (mask >> 1) & 1;
+        selected[i + 2] &= (mask >> 2) & 1;
+        selected[i + 3] &= (mask >> 3) & 1;
+    }
+#endif
+    for (; i < size; ++i)
+        selected[i] &= (values[i] >= min) & (values[i] <= max);
+}
+
+void ItemColumns::RangeIds(const SortedColumn &column, double min, double max, Ids *ids) {
+    auto &values = column.values;
+    size_t begin = std::lower_bound(values.begin(), values.end(), min) - values.begin();
+    size_t end = std::upper_bound(values.begin(), values.end(), max) - values.begin();
+    ids->clear();
+    if (begin >= end)
+        return;
+    ids->assign(column.ids.begin() + begin, column.ids.begin() + end);
+    std::sort(ids->begin(), ids->end());
+}
+
+void ItemColumns::SelectFacet(const Selection &facet, Selection *selection) {
+    size_t size = std::min(facet.size(), selection->size());
+    for (size_t i = 0; i < size; ++i)
+        (*selection)[i] &= facet[i];
+}
+
+void ItemColumns::SelectIds(const Ids &ids, Selection *selection) {
+    // Clears the runs between consecutive ids in a single pass
+    unsigned char *selected = selection->data();
+    size_t size = selection->size();
+    size_t next = 0;
+    for (auto id : ids) {
+        if (id >= size)
+            break;
+        if (id < next)
+            continue;
+        std::fill(selected + next, selected + id, 0);
+        next = id + 1;
+    }
+    std::fill(selected + next, selected + size, 0);
+}
@@ -0,0 +1,108 @@
+/*
+    Copyright 2016 Ilya Zhuravlev
+
+    This file is part of Acquisition.
+
+    Acquisition is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Acquisition is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Acquisition.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "item.h"
+#include "trigramindex.h"
+
+/*
+ * ItemColumns keeps numeric attributes of items as a structure of arrays: one
+ * column of doubles per attribute (the value a min/max filter looks at, a
+ * pseudo-mod, ...) in the same order as items().
+ *
+ * A column is built the first time a search asks for it and kept until the
+ * items change, so typing into a min/max box becomes a scan over contiguous
+ * doubles instead of a property lookup and parse per item. Items that don't
+ * have the attribute get Missing() (NaN), which fails every range check.
+ *
+ * Attributes few items have (pseudo-mods) can instead be looked up in a
+ * SortedColumn: the ids of the items having them ordered by value, so a range
+ * is two binary searches and only the items inside it are touched.
+ *
+ * Yes/no attributes (MTX, alt art, gear type, ...) are kept as facets: a
+ * Selection of the items having them, which a search simply ANDs into its own.
+ *
+ * Texts (names, mods) are searched through a TrigramIndex per attribute, built
+ * and kept the same way.
+ *
+ * Columns are built lazily by const methods, like the rest of the search this
+ * is only meant to be used from the GUI thread.
+ */
+class ItemColumns {
+public:
+    typedef std::vector<double> Column;
+    // Items having an attribute, ordered by its value
+    struct SortedColumn {
+        std::vector<double> values;
+        std::vector<uint32_t> ids;
+    };
+    typedef std::vector<uint32_t> Ids;
+    // One entry per item, non-zero if the item is still selected.
+    // Bytes rather than bits so that range scans vectorize.
+    typedef std::vector<unsigned char> Selection;
+    typedef std::function<double(const std::shared_ptr<Item> &item)> ValueFunction;
+    typedef std::function<std::string(const std::shared_ptr<Item> &item)> TextFunction;
+    typedef std::function<bool(const std::shared_ptr<Item> &item)> Predicate;
+
+    explicit ItemColumns(const Items &items);
+    // Must be called whenever the items change
+    void Reset();
+    const Items &items() const { return items_; }
+    // Changes on every Reset()
+    unsigned generation() const { return generation_; }
+    // owner and index identify the attribute (e.g. a filter and 0), value is called
+    // for every item when the column is built.
+    const Column &Get(const void *owner, int index, const ValueFunction &value) const;
+    // Same as Get() but sorted, items whose value is Missing() are left out.
+    const SortedColumn &GetSorted(const void *owner, int index, const ValueFunction &value) const;
+    // Items for which predicate holds, owner and index work the same as in Get().
+    const Selection &GetFacet(const void *owner, int index, const Predicate &predicate) const;
+    Selection SelectAll() const { return Selection(items_.size(), 1); }
+    // Deselects items whose text doesn't contain query, ignoring case.
+    // owner identifies the text the same way as in Get(). Returns false, leaving the
+    // selection alone, if the query is too short for the index: every item has to be
+    // checked then, which is better done in parallel by the search.
+    bool SelectText(const void *owner, const TextFunction &text, const std::string &query, Selection *selection) const;
+
+    static double Missing();
+    // Deselects items whose value is not within [min, max]
+    static void SelectRange(const Column &column, double min, double max, Selection *selection);
+    // Fills ids with the items whose value is within [min, max], in ascending order
+    static void RangeIds(const SortedColumn &column, double min, double max, Ids *ids);
+    // Deselects items that are not in facet
+    static void SelectFacet(const Selection &facet, Selection *selection);
+    // Deselects items that are not in ids (ascending)
+    static void SelectIds(const Ids &ids, Selection *selection);
+private:
+    const Items &items_;
+    unsigned generation_{0};
+    mutable std::map<std::pair<const void*, int>, Column> columns_;
+    mutable std::map<std::pair<const void*, int>, SortedColumn> sorted_;
+    mutable std::map<std::pair<const void*, int>, Selection> facets_;
+    mutable std::map<const void*, std::unique_ptr<TrigramIndex>> indexes_;
+};
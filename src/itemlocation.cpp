@@ -74,6 +74,33 @@ void ItemLocation::ToItemJson(rapidjson::Value *root_ptr, rapidjson_allocator &a
     root.AddMember("_socketed", socketed_, alloc);
 }
 
+void ItemLocation::ToItemJson(rapidjson::Writer<rapidjson::StringBuffer> *writer) const {
+    writer->Key("_type");
+    writer->Int(static_cast<int>(type_));
+    if (type_ == ItemLocationType::STASH) {
+        writer->Key("_tab");
+        writer->Int(tab_id_);
+        writer->Key("_tab_label");
+        writer->String(tab_label_.c_str(), tab_label_.size());
+    } else {
+        writer->Key("_character");
+        writer->String(character_.c_str(), character_.size());
+    }
+    if (socketed_) {
+        writer->Key("_x");
+        writer->Int(x_);
+        writer->Key("_y");
+        writer->Int(y_);
+    }
+    writer->Key("_socketed");
+    writer->Bool(socketed_);
+}
+
+bool ItemLocation::IsLocationField(const std::string &name) {
+    return name == "_type" || name == "_tab" || name == "_tab_label" || name == "_character"
+        || name == "_x" || name == "_y" || name == "_socketed";
+}
+
 std::string ItemLocation::GetHeader() const {
     if (type_ == ItemLocationType::STASH) {
         QString format("#%1, \"%2\"");
@@ -127,9 +154,9 @@ std::string ItemLocation::GetUniqueHash() const {
         return "";
 
     if (type_ == ItemLocationType::STASH)
-        return "stash:" + tab_label_;
+        return "stash:" + tab_label_.str();
     else
-        return "character:" + character_;
+        return "character:" + character_.str();
 }
 
 bool ItemLocation::operator<(const ItemLocation &rhs) const {
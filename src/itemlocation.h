@@ -2,7 +2,10 @@
 
 #include <QRectF>
 #include "rapidjson/document.h"
+#include "rapidjson/stringbuffer.h"
+#include "rapidjson/writer.h"
 
+#include "internedstring.h"
 #include "itemconstants.h"
 #include "rapidjson_util.h"
 
@@ -17,7 +20,11 @@ public:
     explicit ItemLocation(const rapidjson::Value &root);
     ItemLocation(int tab_id, std::string name, ItemLocationType = ItemLocationType::STASH);
     void ToItemJson(rapidjson::Value *root, rapidjson_allocator &alloc);
+    // Same as above, for items that are being written out member by member
+    void ToItemJson(rapidjson::Writer<rapidjson::StringBuffer> *writer) const;
     void FromItemJson(const rapidjson::Value &root);
+    // Whether the member is one of the ones added by ToItemJson
+    static bool IsLocationField(const std::string &name);
     std::string GetHeader() const;
     QRectF GetRect() const;
     std::string GetForumCode(const std::string &league) const;
@@ -28,16 +35,22 @@ public:
     void set_character(const std::string &character) { character_ = character; }
     void set_tab_id(int tab_id) { tab_id_ = tab_id; }
     void set_tab_label(const std::string &tab_label) { tab_label_ = tab_label; }
-    std::string get_tab_label() const { return tab_label_; }
+    const std::string &get_tab_label() const { return tab_label_; }
+    const std::string &get_character() const { return character_; }
     bool socketed() const { return socketed_; }
     void set_socketed(bool socketed) { socketed_ = socketed; }
+    void set_position(int x, int y) { x_ = x; y_ = y; }
+    void set_size(int w, int h) { w_ = w; h_ = h; }
+    void set_inventory_id(const std::string &inventory_id) { inventory_id_ = inventory_id; }
     int get_tab_id() const { return tab_id_; }
+    ItemLocationType get_type() const { return type_; }
 private:
+    friend class ItemSnapshotAccess;
     int x_, y_, w_, h_;
     bool socketed_;
     ItemLocationType type_;
     int tab_id_{0};
-    std::string tab_label_;
-    std::string character_;
+    InternedString tab_label_;
+    InternedString character_;
     std::string inventory_id_;
 };
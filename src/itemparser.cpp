@@ -0,0 +1,410 @@
+/*
+    Copyright 2016 Ilya Zhuravlev
+
+    This file is part of Acquisition.
+
+    Acquisition is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Acquisition is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Acquisition.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "itemparser.h"
+
+#include <cctype>
+#include "rapidjson/reader.h"
+
+// An item whose object is still being parsed, or which waits for its parent to finish
+// (socketed items can't be placed before their parent's x/y are known).
+struct ItemParser::PendingItem {
+    std::shared_ptr<Item> item;
+    // frames_.size() right after the item's object was opened
+    size_t depth;
+    // the item's object in the source, without the closing brace and our location fields
+    int json_offset;
+    int json_end{-1};
+    // properties and additionalProperties as they are used in item hashes
+    std::string unique_properties, unique_additional_properties;
+    bool has_sockets{false};
+    int x{0}, y{0}, w{0}, h{0};
+    bool has_x{false}, has_y{false};
+    std::string inventory_id;
+    bool has_inventory_id{false};
+    // location fields of an item that was stored by us before, they win over the tab's
+    bool has_type{false};
+    int type{0}, tab{0}, socketed_x{0}, socketed_y{0};
+    std::string tab_label, character;
+    bool socketed{false};
+    // entry of properties/additionalProperties/requirements/sockets currently being parsed
+    ItemProperty property;
+    int socket_group;
+    char socket_attr;
+    std::vector<std::unique_ptr<PendingItem>> socketed_items;
+};
+
+ItemParser::ItemParser(const ItemLocation &location, Items *items) :
+    location_(location),
+    items_(items),
+    stream_(nullptr),
+    stored_(false),
+    error_(false)
+{}
+
+ItemParser::~ItemParser() {}
+
+bool ItemParser::Parse(const QByteArray &json) {
+    return Parse(json, false);
+}
+
+bool ItemParser::ParseStored(const QByteArray &json) {
+    return Parse(json, true);
+}
+
+bool ItemParser::Parse(const QByteArray &json, bool stored) {
+    // Items keep a reference to it, QByteArray's data is shared rather than copied
+    source_ = json;
+    arena_ = std::make_shared<ItemArena>();
+    stored_ = stored;
+    rapidjson::Reader reader;
+    rapidjson::StringStream stream(source_.constData());
+    stream_ = &stream;
+    bool result = !reader.Parse<rapidjson::kParseDefaultFlags>(stream, *this).IsError();
+    stream_ = nullptr;
+    return result;
+}
+
+int ItemParser::Level(const PendingItem &pending) const {
+    return frames_.size() - pending.depth + 1;
+}
+
+const std::string &ItemParser::KeyAt(const PendingItem &pending, int level) const {
+    return frames_[pending.depth + level - 2].key;
+}
+
+bool ItemParser::IsItemStart() const {
+    if (stored_)
+        return frames_.size() == 1 && frames_[0].array;
+    if (frames_.size() == 2 && frames_[0].key == "items" && frames_[1].array)
+        return true;
+    if (pending_.empty())
+        return false;
+    auto &pending = *pending_.back();
+    return Level(pending) == 2 && KeyAt(pending, 1) == "socketedItems";
+}
+
+int ItemParser::LocationStart() const {
+    // Called from Key(), rapidjson reads strings from a copy of the stream so it still
+    // points at the opening quote of the key. The comma before it goes too.
+    int position = static_cast<int>(stream_->Tell());
+    const char *data = source_.constData();
+    int i = position - 1;
+    while (i > 0 && isspace(static_cast<unsigned char>(data[i])))
+        --i;
+    return data[i] == ',' ? i : position;
+}
+
+void ItemParser::OnScalar() {
+    if (!frames_.empty() && frames_.back().array)
+        ++frames_.back().index;
+}
+
+bool ItemParser::Null() {
+    if (frames_.empty())
+        return false;
+    OnScalar();
+    return true;
+}
+
+bool ItemParser::Bool(bool b) {
+    if (frames_.empty())
+        return false;
+    if (!pending_.empty() && Level(*pending_.back()) == 1) {
+        auto &pending = *pending_.back();
+        auto &key = KeyAt(pending, 1);
+        if (key == "corrupted")
+            pending.item->corrupted_ = b;
+        else if (key == "identified")
+            pending.item->identified_ = b;
+        else if (key == "_socketed")
+            pending.socketed = b;
+    }
+    OnScalar();
+    return true;
+}
+
+bool ItemParser::Int(int i) {
+    if (frames_.empty())
+        return false;
+    OnInteger(i);
+    return true;
+}
+
+bool ItemParser::Uint(unsigned u) {
+    if (frames_.empty())
+        return false;
+    OnInteger(u);
+    return true;
+}
+
+bool ItemParser::Int64(int64_t i) {
+    if (frames_.empty())
+        return false;
+    OnInteger(i);
+    return true;
+}
+
+bool ItemParser::Uint64(uint64_t u) {
+    if (frames_.empty())
+        return false;
+    OnInteger(static_cast<int64_t>(u));
+    return true;
+}
+
+void ItemParser::OnInteger(int64_t value) {
+    if (!pending_.empty()) {
+        auto &pending = *pending_.back();
+        auto &item = *pending.item;
+        int level = Level(pending);
+        int i = static_cast<int>(value);
+        if (level == 1) {
+            auto &key = KeyAt(pending, 1);
+            if (key == "w") {
+                item.w_ = pending.w = i;
+            } else if (key == "h") {
+                item.h_ = pending.h = i;
+            } else if (key == "frameType") {
+                item.frameType_ = i;
+            } else if (key == "ilvl") {
+                item.ilvl_ = i;
+            } else if (key == "x") {
+                pending.x = i;
+                pending.has_x = true;
+            } else if (key == "y") {
+                pending.y = i;
+                pending.has_y = true;
+            } else if (key == "_type") {
+                pending.type = i;
+                pending.has_type = true;
+            } else if (key == "_tab") {
+                pending.tab = i;
+            } else if (key == "_x") {
+                pending.socketed_x = i;
+            } else if (key == "_y") {
+                pending.socketed_y = i;
+            }
+        } else if (level == 3) {
+            auto &key = KeyAt(pending, 3);
+            if (key == "displayMode")
+                pending.property.display_mode = i;
+            else if (key == "group")
+                pending.socket_group = i;
+        } else if (level == 5 && KeyAt(pending, 3) == "values" && frames_.back().index == 1
+                && !pending.property.values.empty()) {
+            pending.property.values.back().type = i;
+        }
+    }
+    OnScalar();
+}
+
+bool ItemParser::Double(double d) {
+    if (frames_.empty())
+        return false;
+    OnScalar();
+    return true;
+}
+
+bool ItemParser::String(const char *str, rapidjson::SizeType length, bool /*copy*/) {
+    if (frames_.empty())
+        return false;
+    if (!pending_.empty()) {
+        auto &pending = *pending_.back();
+        auto &item = *pending.item;
+        int level = Level(pending);
+        if (level == 1) {
+            auto &key = KeyAt(pending, 1);
+            if (key == "name")
+                item.name_.assign(str, length);
+            else if (key == "typeLine")
+                item.typeLine_ = InternedString(str, length);
+            else if (key == "icon")
+                item.icon_ = InternedString(str, length);
+            else if (key == "id")
+                item.uid_.assign(str, length);
+            else if (key == "note")
+                item.note_.assign(str, length);
+            else if (key == "inventoryId") {
+                pending.inventory_id.assign(str, length);
+                pending.has_inventory_id = true;
+            } else if (key == "_tab_label")
+                pending.tab_label.assign(str, length);
+            else if (key == "_character")
+                pending.character.assign(str, length);
+        } else if (level == 2) {
+            auto it = item.text_mods_.find(KeyAt(pending, 1));
+            if (it != item.text_mods_.end())
+                it->second.push_back(std::string(str, length));
+        } else if (level == 3) {
+            auto &key = KeyAt(pending, 3);
+            if (key == "name")
+                pending.property.name = InternedString(str, length);
+            else if (key == "attr" && length > 0)
+                pending.socket_attr = str[0];
+        } else if (level == 5 && KeyAt(pending, 3) == "values" && frames_.back().index == 0
+                && !pending.property.values.empty()) {
+            pending.property.values.back().str.assign(str, length);
+        }
+    }
+    OnScalar();
+    return true;
+}
+
+bool ItemParser::StartObject() {
+    if (frames_.empty()) {
+        if (stored_)
+            return false;
+        frames_.push_back({ false, "", 0 });
+        return true;
+    }
+
+    bool item_start = IsItemStart();
+    if (!item_start && !pending_.empty() && Level(*pending_.back()) == 2) {
+        auto &pending = *pending_.back();
+        pending.property = ItemProperty();
+        pending.property.display_mode = 0;
+        pending.socket_group = 0;
+        pending.socket_attr = 0;
+    }
+    frames_.push_back({ false, "", 0 });
+
+    if (item_start) {
+        std::unique_ptr<PendingItem> pending(new PendingItem());
+        pending->item = ItemArena::NewItem(arena_);
+        pending->depth = frames_.size();
+        // the opening brace has just been read
+        pending->json_offset = static_cast<int>(stream_->Tell()) - 1;
+        pending_.push_back(std::move(pending));
+    }
+    return true;
+}
+
+bool ItemParser::Key(const char *str, rapidjson::SizeType length, bool /*copy*/) {
+    frames_.back().key.assign(str, length);
+
+    if (frames_.size() == 1 && frames_.back().key == "error")
+        error_ = true;
+    if (!pending_.empty() && Level(*pending_.back()) == 1) {
+        auto &pending = *pending_.back();
+        auto &key = frames_.back().key;
+        if (key == "cosmeticMods")
+            pending.item->has_mtx_ = true;
+        else if (key == "sockets")
+            pending.has_sockets = true;
+        else if (ItemLocation::IsLocationField(key) && pending.json_end < 0)
+            pending.json_end = LocationStart();
+    }
+    return true;
+}
+
+bool ItemParser::EndObject(rapidjson::SizeType /*member_count*/) {
+    if (!pending_.empty() && frames_.size() == pending_.back()->depth) {
+        std::unique_ptr<PendingItem> done = std::move(pending_.back());
+        pending_.pop_back();
+        // the closing brace has just been read
+        if (done->json_end < 0)
+            done->json_end = static_cast<int>(stream_->Tell()) - 1;
+        frames_.pop_back();
+        OnScalar();
+        if (pending_.empty())
+            Finish(done.get(), location_);
+        else
+            pending_.back()->socketed_items.push_back(std::move(done));
+        return true;
+    }
+
+    if (!pending_.empty() && Level(*pending_.back()) == 3)
+        OnEntryEnd(pending_.back().get());
+    frames_.pop_back();
+    OnScalar();
+    return true;
+}
+
+bool ItemParser::StartArray() {
+    if (frames_.empty() && !stored_)
+        return false;
+    // a new [value, type] pair of a property
+    if (!pending_.empty() && Level(*pending_.back()) == 4 && KeyAt(*pending_.back(), 3) == "values")
+        pending_.back()->property.values.push_back({ "", 0 });
+    frames_.push_back({ true, "", 0 });
+    return true;
+}
+
+bool ItemParser::EndArray(rapidjson::SizeType /*element_count*/) {
+    frames_.pop_back();
+    OnScalar();
+    return true;
+}
+
+void ItemParser::OnEntryEnd(PendingItem *pending) {
+    auto &list = KeyAt(*pending, 1);
+    auto &property = pending->property;
+    if (list == "properties" || list == "additionalProperties") {
+        std::string unique = property.name.str() + "~";
+        for (auto &value : property.values)
+            unique += value.str + "~";
+        if (list == "properties") {
+            pending->unique_properties += unique;
+            pending->item->AddProperty(property);
+        } else {
+            pending->unique_additional_properties += unique;
+        }
+    } else if (list == "requirements") {
+        if (!property.values.empty())
+            pending->item->AddRequirement(property.name, property.values[0]);
+    } else if (list == "sockets") {
+        ItemSocket socket = { static_cast<unsigned char>(pending->socket_group), pending->socket_attr };
+        pending->item->text_sockets_.push_back(socket);
+    }
+}
+
+void ItemParser::Finish(PendingItem *pending, const ItemLocation &base_location) {
+    ItemLocation location(base_location);
+    if (pending->has_type) {
+        location.set_type(static_cast<ItemLocationType>(pending->type));
+        if (location.get_type() == ItemLocationType::STASH) {
+            location.set_tab_label(pending->tab_label);
+            location.set_tab_id(pending->tab);
+        } else {
+            location.set_character(pending->character);
+        }
+        location.set_socketed(pending->socketed);
+        if (pending->socketed)
+            location.set_position(pending->socketed_x, pending->socketed_y);
+    }
+    if (pending->has_x && pending->has_y)
+        location.set_position(pending->x, pending->y);
+    location.set_size(pending->w, pending->h);
+    if (pending->has_inventory_id)
+        location.set_inventory_id(pending->inventory_id);
+
+    auto &item = *pending->item;
+    item.json_source_ = source_;
+    item.json_offset_ = pending->json_offset;
+    item.json_size_ = pending->json_end - pending->json_offset;
+    // The item only knows the inventory it's in if the json says so
+    item.location_ = location;
+    item.location_.set_inventory_id(pending->inventory_id);
+    item.Finish(pending->unique_properties, pending->unique_additional_properties, pending->has_sockets);
+    items_->push_back(pending->item);
+
+    location.set_socketed(true);
+    for (auto &socketed : pending->socketed_items)
+        Finish(socketed.get(), location);
+}
@@ -0,0 +1,100 @@
+/*
+    Copyright 2016 Ilya Zhuravlev
+
+    This file is part of Acquisition.
+
+    Acquisition is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Acquisition is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Acquisition.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <QByteArray>
+#include "rapidjson/document.h"
+
+#include "item.h"
+#include "itemarena.h"
+#include "itemlocation.h"
+
+/*
+ * ItemParser builds Items straight from a stash/character items reply without
+ * creating a DOM for it first.
+ *
+ * It is a rapidjson SAX handler which picks up the fields Item needs as they come.
+ * Items don't get a copy of their json: they keep a reference to the buffer that
+ * was parsed along with the range their object occupies in it (see Item::json).
+ */
+class ItemParser {
+public:
+    ItemParser(const ItemLocation &location, Items *items);
+    ~ItemParser();
+    // Returns false if the reply is malformed or is not an object.
+    bool Parse(const QByteArray &json);
+    // Parses items saved by us: a flat array of items which already carry their
+    // locations, socketed items are separate entries there.
+    bool ParseStored(const QByteArray &json);
+    // The reply was an error message instead of items
+    bool error() const { return error_; }
+
+    // rapidjson Handler
+    bool Null();
+    bool Bool(bool b);
+    bool Int(int i);
+    bool Uint(unsigned u);
+    bool Int64(int64_t i);
+    bool Uint64(uint64_t u);
+    bool Double(double d);
+    bool String(const char *str, rapidjson::SizeType length, bool copy);
+    bool StartObject();
+    bool Key(const char *str, rapidjson::SizeType length, bool copy);
+    bool EndObject(rapidjson::SizeType member_count);
+    bool StartArray();
+    bool EndArray(rapidjson::SizeType element_count);
+private:
+    struct Frame {
+        bool array;
+        // last key seen in an object
+        std::string key;
+        // number of values seen so far in an array
+        int index;
+    };
+    struct PendingItem;
+
+    bool Parse(const QByteArray &json, bool stored);
+    // Nesting level of the current value relative to the item, 1 for the item's own members
+    int Level(const PendingItem &pending) const;
+    // Key of the member currently being parsed at the given level of the item
+    const std::string &KeyAt(const PendingItem &pending, int level) const;
+    bool IsItemStart() const;
+    // Offset in the source where the location fields stored with the item start
+    int LocationStart() const;
+    void OnScalar();
+    void OnInteger(int64_t value);
+    void OnEntryEnd(PendingItem *pending);
+    void Finish(PendingItem *pending, const ItemLocation &base_location);
+
+    ItemLocation location_;
+    Items *items_;
+    QByteArray source_;
+    // Items of one reply share an arena the same way they share source_
+    std::shared_ptr<ItemArena> arena_;
+    rapidjson::StringStream *stream_;
+    bool stored_;
+    std::vector<Frame> frames_;
+    // Items whose objects are still open, innermost last
+    std::vector<std::unique_ptr<PendingItem>> pending_;
+    bool error_;
+};
@@ -19,6 +19,9 @@
 
 #include "items_model.h"
 
+#include <vector>
+#include <QtConcurrent>
+
 #include "application.h"
 #include "bucket.h"
 #include "buyoutmanager.h"
@@ -104,13 +107,37 @@ QVariant ItemsModel::data(const QModelIndex &index, int role) const {
         }
         return QVariant();
     }
-    auto &column = search_.columns()[index.column()];
+    if (role != Qt::DisplayRole && role != Qt::ForegroundRole)
+        return QVariant();
     const Item &item = *search_.bucket(index.parent().row())->item(index.row());
-    if (role == Qt::DisplayRole)
-        return column->value(item);
-    else if (role == Qt::ForegroundRole)
+    auto &column = search_.columns()[index.column()];
+    if (!column->cacheable()) {
+        if (role == Qt::DisplayRole)
+            return column->value(item);
         return column->color(item);
-    return QVariant();
+    }
+    const CachedCell &cell = Cell(item, index.column());
+    if (role == Qt::DisplayRole)
+        return cell.display;
+    return cell.foreground;
+}
+
+const ItemsModel::CachedCell &ItemsModel::Cell(const Item &item, int column) const {
+    if (cache_generation_ != bo_manager_.generation()) {
+        cache_.clear();
+        cache_generation_ = bo_manager_.generation();
+    }
+    auto &cells = cache_[&item];
+    if (cells.empty())
+        cells.resize(search_.columns().size());
+    CachedCell &cell = cells[column];
+    if (!cell.filled) {
+        auto &column_obj = search_.columns()[column];
+        cell.display = column_obj->value(item);
+        cell.foreground = column_obj->color(item);
+        cell.filled = true;
+    }
+    return cell;
 }
 
 Qt::ItemFlags ItemsModel::flags(const QModelIndex &index) const
@@ -161,10 +188,14 @@ void ItemsModel::sort(int column, Qt::SortOrder order)
     sort_order_ = order;
     sort_column_ = column;
 
+    // Buckets are sorted in parallel, columns only read items and buyouts
     auto &column_obj = search_.columns()[column];
-    for (const auto &bucket: search_.buckets()) {
+    std::vector<Bucket*> buckets;
+    for (const auto &bucket: search_.buckets())
+        buckets.push_back(bucket.get());
+    QtConcurrent::blockingMap(buckets, [&](Bucket *bucket) {
         bucket->Sort(*column_obj, order);
-    }
+    });
     layoutChanged();
     SetSorted(true);
 }
@@ -20,6 +20,8 @@
 #pragma once
 
 #include <QAbstractItemModel>
+#include <unordered_map>
+#include <vector>
 
 #include "column.h"
 #include "item.h"
@@ -44,11 +46,25 @@ public:
     Qt::SortOrder GetSortOrder() { return sort_order_;};
     int GetSortColumn() { return sort_column_;};
     void SetSorted(bool val) { sorted_ = val; };
+    // Must be called when the items shown change, buyout changes are picked up on their own
+    void InvalidateCache() { cache_.clear(); }
 
 private:
+    // Values of a cell as they were when it was first shown
+    struct CachedCell {
+        CachedCell() : filled(false) {}
+        bool filled;
+        QVariant display, foreground;
+    };
+    const CachedCell &Cell(const Item &item, int column) const;
+
     BuyoutManager &bo_manager_;
     const Search &search_;
     Qt::SortOrder sort_order_{Qt::DescendingOrder};
     int sort_column_{0};
     bool sorted_{false};
+    // Columns format values (buyouts, DPS, ...) on every paint, so painted cells of
+    // cacheable() columns are kept until the items or buyouts change.
+    mutable std::unordered_map<const Item*, std::vector<CachedCell>> cache_;
+    mutable unsigned cache_generation_{0};
 };
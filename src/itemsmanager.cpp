@@ -20,6 +20,7 @@
 #include "itemsmanager.h"
 
 #include <QThread>
+#include <set>
 #include <stdexcept>
 
 #include "application.h"
@@ -37,7 +38,8 @@ ItemsManager::ItemsManager(Application &app) :
     data_(app.data()),
     bo_manager_(app.buyout_manager()),
     shop_(app.shop()),
-    app_(app)
+    app_(app),
+    columns_(items_)
 {
     auto_update_interval_ = std::stoi(data_.Get("autoupdate_interval", "30"));
     auto_update_ = data_.GetBool("autoupdate", true);
@@ -56,7 +58,7 @@ void ItemsManager::Start() {
     connect(thread_.get(), SIGNAL(started()), worker_.get(), SLOT(Init()));
     connect(this, SIGNAL(UpdateSignal(TabCache::Policy, const std::vector<ItemLocation> &)), worker_.get(), SLOT(Update(TabCache::Policy, const std::vector<ItemLocation> &)));
     connect(worker_.get(), &ItemsManagerWorker::StatusUpdate, this, &ItemsManager::OnStatusUpdate);
-    connect(worker_.get(), SIGNAL(ItemsRefreshed(Items, std::vector<ItemLocation>, bool)), this, SLOT(OnItemsRefreshed(Items, std::vector<ItemLocation>, bool)));
+    connect(worker_.get(), SIGNAL(ItemsRefreshed(Items, std::vector<ItemLocation>, ItemsChangeSet, bool)), this, SLOT(OnItemsRefreshed(Items, std::vector<ItemLocation>, ItemsChangeSet, bool)));
     worker_->moveToThread(thread_.get());
     thread_->start();
 }
@@ -87,9 +89,14 @@ void ItemsManager::ApplyAutoTabBuyouts() {
 }
 
 void ItemsManager::ApplyAutoItemBuyouts() {
-    // Loop over all items, check for note field with pricing and apply
+    ApplyAutoItemBuyouts(items_);
+    app_.buyout_manager().CompressItemBuyouts(items_);
+}
+
+void ItemsManager::ApplyAutoItemBuyouts(const Items &items) {
+    // Loop over items, check for note field with pricing and apply
     auto &bo = app_.buyout_manager();
-    for (auto const& item: items_) {
+    for (auto const& item: items) {
         auto const &note = item->note();
         if (!note.empty()) {
             Buyout buyout = bo.StringToBuyout(note);
@@ -102,51 +109,115 @@ void ItemsManager::ApplyAutoItemBuyouts() {
             }
         }
     }
-
-    bo.CompressItemBuyouts(items_);
 }
 
 void ItemsManager::PropagateTabBuyouts() {
     auto &bo = app_.buyout_manager();
     bo.ClearRefreshLocks();
-    for (auto &item_ptr : items_) {
-        Item &item = *item_ptr;
-        std::string hash = item.location().GetUniqueHash();
-        auto item_bo = bo.Get(item);
-        auto tab_bo = bo.GetTab(hash);
-
-        if (item_bo.IsInherited()) {
-            if (tab_bo.IsActive()) {
-                // Any propagation from tab price to item price should include this bit set
-                tab_bo.inherited = true;
-                tab_bo.last_update = QDateTime::currentDateTime();
-                bo.Set(item, tab_bo);
-            } else {
-                // This effectively 'clears' buyout by setting back to 'inherit' state.
-                bo.Set(item, Buyout());
-            }
+    for (auto &item : items_)
+        PropagateTabBuyout(*item);
+}
+
+void ItemsManager::PropagateTabBuyout(const Item &item) {
+    auto &bo = app_.buyout_manager();
+    std::string hash = item.location().GetUniqueHash();
+    auto item_bo = bo.Get(item);
+    auto tab_bo = bo.GetTab(hash);
+
+    if (item_bo.IsInherited()) {
+        if (tab_bo.IsActive()) {
+            // Any propagation from tab price to item price should include this bit set
+            tab_bo.inherited = true;
+            tab_bo.last_update = QDateTime::currentDateTime();
+            bo.Set(item, tab_bo);
+        } else {
+            // This effectively 'clears' buyout by setting back to 'inherit' state.
+            bo.Set(item, Buyout());
+        }
+    }
+
+    // If any savable bo's are set on an item or the tab then lock
+    // the refresh state.
+    if (bo.Get(item).RequiresRefresh() || tab_bo.RequiresRefresh()) {
+        bo.SetRefreshLocked(item.location());
+    }
+}
+
+void ItemsManager::UpdateHashCounts(const ItemsChangeSet &changes) {
+    std::set<std::string> decreased;
+    for (auto &pair : changes) {
+        const TabChanges &tab = pair.second;
+        for (auto &item : tab.added)
+            ++hash_count_[item->hash()];
+        for (auto &modified : tab.modified) {
+            --hash_count_[modified.first->hash()];
+            decreased.insert(modified.first->hash());
+            ++hash_count_[modified.second->hash()];
+        }
+        for (auto &item : tab.removed) {
+            --hash_count_[item->hash()];
+            decreased.insert(item->hash());
         }
+    }
 
-        // If any savable bo's are set on an item or the tab then lock
-        // the refresh state.
-        if (bo.Get(item).RequiresRefresh() || tab_bo.RequiresRefresh()) {
-            bo.SetRefreshLocked(item.location());
+    // Checked only after all changes are counted: an item moved to another tab
+    // is removed from one and added to the other, its buyout must stay.
+    for (auto &hash : decreased) {
+        auto it = hash_count_.find(hash);
+        if (it != hash_count_.end() && it->second <= 0) {
+            bo_manager_.Remove(hash);
+            hash_count_.erase(it);
         }
     }
 }
 
-void ItemsManager::OnItemsRefreshed(const Items &items, const std::vector<ItemLocation> &tabs, bool initial_refresh) {
+void ItemsManager::OnItemsRefreshed(const Items &items, const std::vector<ItemLocation> &tabs, const ItemsChangeSet &changes, bool initial_refresh) {
     items_ = items;
+    columns_.Reset();
+    changes_ = changes;
 
     bo_manager_.SetStashTabLocations(tabs);
     MigrateBuyouts();
     ApplyAutoTabBuyouts();
-    ApplyAutoItemBuyouts();
-    PropagateTabBuyouts();
+
+    if (initial_refresh) {
+        ApplyAutoItemBuyouts();
+        PropagateTabBuyouts();
+        hash_count_.clear();
+        for (auto &item : items_)
+            ++hash_count_[item->hash()];
+    } else {
+        // Only the locations that changed need to be looked at
+        for (auto &pair : changes_) {
+            const TabChanges &tab = pair.second;
+            Items changed(tab.added);
+            for (auto &modified : tab.modified)
+                changed.push_back(modified.second);
+            ApplyAutoItemBuyouts(changed);
+        }
+        UpdateHashCounts(changes_);
+        for (auto &pair : changes_) {
+            bo_manager_.ClearRefreshLock(pair.first);
+            for (auto &item : pair.second.items)
+                PropagateTabBuyout(*item);
+        }
+    }
 
     emit ItemsRefreshed(initial_refresh);
 }
 
+void ItemsManager::OnItemsRefreshed(const Items &items, const std::vector<ItemLocation> &tabs, bool initial_refresh) {
+    ItemsChangeSet changes;
+    for (auto &item : items_)
+        changes[item->location()].removed.push_back(item);
+    for (auto &item : items) {
+        TabChanges &tab = changes[item->location()];
+        tab.items.push_back(item);
+        tab.added.push_back(item);
+    }
+    OnItemsRefreshed(items, tabs, changes, initial_refresh);
+}
+
 void ItemsManager::Update(TabCache::Policy policy, const std::vector<ItemLocation> &locations) {
     emit UpdateSignal(policy, locations);
 }
@@ -23,6 +23,7 @@
 #include <memory>
 
 #include "item.h"
+#include "itemcolumns.h"
 #include "itemsmanagerworker.h"
 #include "tabcache.h"
 
@@ -51,6 +52,10 @@ public:
     int auto_update_interval() const { return auto_update_interval_; }
     bool auto_update() const { return auto_update_; }
     const Items &items() const { return items_; }
+    // Numeric attributes of items() for searches
+    const ItemColumns &columns() const { return columns_; }
+    // What changed during the last refresh
+    const ItemsChangeSet &changes() const { return changes_; }
     void ApplyAutoTabBuyouts();
     void ApplyAutoItemBuyouts();
     void PropagateTabBuyouts();
@@ -59,6 +64,8 @@ public slots:
     void OnAutoRefreshTimer();
     // Used to glue Worker's signals to MainWindow
     void OnStatusUpdate(const CurrentStatusUpdate &status);
+    void OnItemsRefreshed(const Items &items, const std::vector<ItemLocation> &tabs, const ItemsChangeSet &changes, bool initial_refresh);
+    // Treats items as a replacement for all current items
     void OnItemsRefreshed(const Items &items, const std::vector<ItemLocation> &tabs, bool initial_refresh);
 signals:
     void UpdateSignal(TabCache::Policy policy = TabCache::DefaultCache, const std::vector<ItemLocation>& tab_names = std::vector<ItemLocation>());
@@ -66,6 +73,10 @@ signals:
     void StatusUpdate(const CurrentStatusUpdate &status);
 private:
     void MigrateBuyouts();
+    void ApplyAutoItemBuyouts(const Items &items);
+    void PropagateTabBuyout(const Item &item);
+    // Keeps track of how many items share each hash, buyouts of hashes that are gone are removed
+    void UpdateHashCounts(const ItemsChangeSet &changes);
 
     // should items be automatically refreshed
     bool auto_update_;
@@ -79,4 +90,7 @@ private:
     Shop &shop_;
     Application &app_;
     Items items_;
+    ItemColumns columns_;
+    ItemsChangeSet changes_;
+    std::map<std::string, int> hash_count_;
 };
@@ -19,6 +19,10 @@
 
 #include "itemsmanagerworker.h"
 
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
 #include <QNetworkAccessManager>
 #include <QNetworkCookie>
 #include <QNetworkCookieJar>
@@ -27,6 +31,7 @@
 #include "QsLog.h"
 #include <QTimer>
 #include <QUrlQuery>
+#include <QtConcurrent>
 #include <algorithm>
 #include "rapidjson/document.h"
 #include "rapidjson/error/en.h"
@@ -39,19 +44,34 @@
 #include "mainwindow.h"
 #include "buyoutmanager.h"
 #include "filesystem.h"
+#include "itemarena.h"
+#include "itemparser.h"
+#include "itemsnapshot.h"
+#include "sqlitedatastore.h"
 
 const char *kStashItemsUrl = "https://www.pathofexile.com/character-window/get-stash-items";
 const char *kCharacterItemsUrl = "https://www.pathofexile.com/character-window/get-items";
 const char *kGetCharactersUrl = "https://www.pathofexile.com/character-window/get-characters";
 const char *kMainPage = "https://www.pathofexile.com/";
+// Generation of the items snapshot that matches the items table, empty if none does
+const char *kSnapshotKey = "items_snapshot";
+// Property of bootstrap replies with the update_id_ they were requested by
+const char *kUpdateProperty = "update_id";
+// Don't bother telling the user we're throttled unless the wait is noticeable
+const qint64 kPausedStatusDelay = 5000;
 
 ItemsManagerWorker::ItemsManagerWorker(Application &app, QThread *thread) :
     data_(app.data()),
+    rate_limiter_(data_),
+    checkpoint_(data_),
+    fetch_timer_(new QTimer(this)),
     signal_mapper_(nullptr),
     league_(app.league()),
     updating_(false),
     bo_manager_(app.buyout_manager()),
-    account_name_(app.email())
+    account_name_(app.email()),
+    snapshot_file_(Filesystem::UserDir() + "/snapshots/" + SqliteDataStore::MakeFilename(app.email(), app.league())),
+    random_(static_cast<std::mt19937::result_type>(QDateTime::currentMSecsSinceEpoch()))
 {
     QUrl poe(kMainPage);
 
@@ -67,22 +87,63 @@ ItemsManagerWorker::ItemsManagerWorker(Application &app, QThread *thread) :
     network_manager_.cookieJar()->setCookiesFromUrl(app.logged_in_nm().cookieJar()->cookiesForUrl(poe), poe);
     network_manager_.moveToThread(thread);
 
-    connect(this, SIGNAL(ItemsRefreshed(Items, std::vector<ItemLocation>, bool)), tab_cache_, SLOT(OnItemsRefreshed()));
+    fetch_timer_->setSingleShot(true);
+    connect(fetch_timer_, SIGNAL(timeout()), this, SLOT(FetchItems()));
+
+    connect(this, SIGNAL(ItemsRefreshed(Items, std::vector<ItemLocation>, ItemsChangeSet, bool)), tab_cache_, SLOT(OnItemsRefreshed()));
 }
 
 ItemsManagerWorker::~ItemsManagerWorker() {
+    rate_limiter_.Save();
+    // The checkpoint is only written every few locations, the next start resumes from it
+    if (updating_)
+        checkpoint_.Save();
     if (signal_mapper_)
         delete signal_mapper_;
 }
 
 void ItemsManagerWorker::Init() {
     items_.clear();
-    std::string items = data_.Get("items");
-    if (items.size() != 0) {
-        rapidjson::Document doc;
-        doc.Parse(items.c_str());
-        for (auto item = doc.Begin(); item != doc.End(); ++item)
-            items_.push_back(std::make_shared<Item>(*item));
+    tab_items_.clear();
+    ItemsChangeSet changes;
+    Items items;
+    bool from_snapshot = LoadSnapshot(&items);
+    std::vector<std::string> locations = data_.GetItemLocations();
+    if (from_snapshot) {
+        QLOG_DEBUG() << "Loaded" << items.size() << "items from the snapshot";
+    } else if (!locations.empty()) {
+        for (auto &location : locations)
+            LoadItems(location, &items);
+    } else {
+        // Older versions kept all items in a single blob, move them to the items table
+        std::string blob = data_.Get("items");
+        if (blob.size() != 0) {
+            ItemParser parser(ItemLocation(), &items);
+            if (!parser.ParseStored(QByteArray::fromStdString(blob)))
+                QLOG_ERROR() << "Malformed items data, some items may be missing.";
+        }
+    }
+
+    for (auto &parsed : items) {
+        tab_items_[parsed->location()].push_back(parsed);
+        // Everything is new to the rest of the application
+        TabChanges &tab = changes[parsed->location()];
+        tab.items.push_back(parsed);
+        tab.added.push_back(parsed);
+    }
+    for (auto &pair : tab_items_)
+        items_.insert(items_.end(), pair.second.begin(), pair.second.end());
+
+    if (locations.empty() && !items_.empty()) {
+        QLOG_INFO() << "Moving" << items_.size() << "items to the items table";
+        for (auto &pair : tab_items_)
+            unstored_.insert(pair.first);
+        StoreUnstored();
+        // The old blob is only dropped once everything is in the items table
+        if (unstored_.empty())
+            data_.Set("items", "");
+    } else if (!from_snapshot && !items_.empty()) {
+        SaveSnapshot();
     }
 
     tabs_.clear();
@@ -105,7 +166,7 @@ void ItemsManagerWorker::Init() {
                 tabs_.push_back(ItemLocation(index, tab["n"].GetString()));
         }
     }
-    emit ItemsRefreshed(items_, tabs_, true);
+    emit ItemsRefreshed(items_, tabs_, changes, true);
 }
 
 void ItemsManagerWorker::Update(TabCache::Policy policy, const std::vector<ItemLocation> &tab_names) {
@@ -114,34 +175,99 @@ void ItemsManagerWorker::Update(TabCache::Policy policy, const std::vector<ItemL
         return;
     }
 
+    selected_locations_.clear();
     if (policy == TabCache::ManualCache) {
-        for (auto const &tab: tab_names)
+        for (auto const &tab: tab_names) {
             tab_cache_->AddManualRefresh(tab);
+            selected_locations_.insert(tab.GetUniqueHash());
+        }
     }
 
     tab_cache_->OnPolicyUpdate(policy);
 
     QLOG_DEBUG() << "Updating stash tabs";
     updating_ = true;
+    ++update_id_;
     // remove all mappings (from previous requests)
     if (signal_mapper_)
         delete signal_mapper_;
     signal_mapper_ = new QSignalMapper;
+    connect(signal_mapper_, SIGNAL(mapped(int)), this, SLOT(OnTabReceived(int)));
     // remove all pending requests
-    queue_ = std::queue<ItemsRequest>();
+    queue_.clear();
+    fetch_timer_->stop();
     queue_id_ = 0;
     replies_.clear();
-    items_.clear();
+    received_items_.clear();
+    received_hashes_.clear();
+    requested_tabs_.clear();
+    current_tabs_.clear();
+    total_completed_ = total_needed_ = total_cached_ = 0;
+    characters_received_ = tabs_received_ = main_page_received_ = false;
     tabs_as_string_ = "";
     selected_character_ = "";
+    LoadCheckpoint(policy);
 
-    // first, download the main page because it's the only way to know which character is selected
+    // The main page (the only way to know which character is selected), the character list
+    // and the tabs list don't depend on each other so they are all requested at once.
+    // They can't wait for the limiter: everything else is ordered by what they return.
     QNetworkReply *main_page = network_manager_.get(Request(QUrl(kMainPage), ItemLocation(), TabCache::Refresh));
+    main_page->setProperty(kUpdateProperty, update_id_);
     connect(main_page, &QNetworkReply::finished, this, &ItemsManagerWorker::OnMainPageReceived);
+
+    rate_limiter_.OnRequestSent(QDateTime::currentMSecsSinceEpoch());
+    QNetworkReply *characters = network_manager_.get(Request(QUrl(kGetCharactersUrl), ItemLocation(), TabCache::Refresh));
+    characters->setProperty(kUpdateProperty, update_id_);
+    connect(characters, &QNetworkReply::finished, this, &ItemsManagerWorker::OnCharacterListReceived);
+
+    // Fetch a single tab and also request tabs list.  We can fetch any tab here with tabs list
+    // appended, so prefer the most important one we know of.  Default to index '1' which is
+    // first user visible tab.
+    first_fetch_tab_ = 1;
+    auto first_priority = ItemsRequestQueue::Refill;
+    for (auto const &tab : tabs_) {
+        auto priority = RequestPriority(tab);
+        if (priority < first_priority) {
+            first_fetch_tab_ = tab.get_tab_id();
+            first_priority = priority;
+        }
+    }
+    rate_limiter_.OnRequestSent(QDateTime::currentMSecsSinceEpoch());
+    QNetworkReply *first_tab = network_manager_.get(MakeTabRequest(first_fetch_tab_, ItemLocation(), true));
+    first_tab->setProperty(kUpdateProperty, update_id_);
+    connect(first_tab, SIGNAL(finished()), this, SLOT(OnFirstTabReceived()));
+
+    // Tabs are rarely added or moved, so don't wait for the tabs list and start on the ones
+    // we know about. Requests that turn out to be wrong are dropped in OnFirstTabReceived.
+    for (auto const &tab : tabs_) {
+        if (tab.get_tab_id() != first_fetch_tab_ && !requested_tabs_.count(TabKey(tab)))
+            QueueRequest(MakeTabRequest(tab.get_tab_id(), tab), tab);
+    }
+    FetchItems();
+}
+
+bool ItemsManagerWorker::IsCurrentReply(QNetworkReply *reply) const {
+    if (reply->property(kUpdateProperty).toInt() == update_id_)
+        return true;
+    QLOG_DEBUG() << "Ignoring a reply to a request made by an earlier refresh";
+    reply->deleteLater();
+    return false;
+}
+
+void ItemsManagerWorker::AbortUpdate() {
+    queue_.clear();
+    fetch_timer_->stop();
+    replies_.clear();
+    // Replies that are still on their way belong to a refresh that's over
+    ++update_id_;
+    updating_ = false;
+    checkpoint_.Save();
 }
 
 void ItemsManagerWorker::OnMainPageReceived() {
     QNetworkReply *reply = qobject_cast<QNetworkReply *>(QObject::sender());
+    if (!IsCurrentReply(reply))
+        return;
     std::string page(reply->readAll().constData());
 
     selected_character_ = Util::FindTextBetween(page, "activeCharacter\":{\"name\":\"", "\",\"league");
@@ -149,16 +275,20 @@ void ItemsManagerWorker::OnMainPageReceived() {
         QLOG_WARN() << "Can't extract selected character name from the page";
     }
 
-    // now get character list
-    QNetworkReply *characters = network_manager_.get(Request(QUrl(kGetCharactersUrl), ItemLocation(), TabCache::Refresh));
-    connect(characters, &QNetworkReply::finished, this, &ItemsManagerWorker::OnCharacterListReceived);
-
     reply->deleteLater();
+    main_page_received_ = true;
+    // Cached tabs may have finished before the page did
+    if (UpdateCompleted())
+        FinishUpdate();
 }
 
 void ItemsManagerWorker::OnCharacterListReceived() {
     QNetworkReply *reply = qobject_cast<QNetworkReply *>(QObject::sender());
+    if (!IsCurrentReply(reply))
+        return;
+    rate_limiter_.OnReply(reply);
     QByteArray bytes = reply->readAll();
+    reply->deleteLater();
     rapidjson::Document doc;
     doc.Parse(bytes.constData());
 
@@ -168,12 +298,13 @@ void ItemsManagerWorker::OnCharacterListReceived() {
         if (doc.HasParseError()) {
             QLOG_ERROR() << "The error was" << rapidjson::GetParseError_En(doc.GetParseError());
         }
-        updating_ = false;
+        AbortUpdate();
         return;
     }
 
     QLOG_DEBUG() << "Received character list, there are" << doc.Size() << "characters";
     auto char_count = 0;
+    std::set<std::string> characters;
     for (auto &character : doc) {
         if (!character.HasMember("league") || !character.HasMember("name") || !character["league"].IsString() || !character["name"].IsString()) {
             QLOG_ERROR() << "Malformed character entry, the reply is most likely invalid" << bytes.constData();
@@ -185,8 +316,22 @@ void ItemsManagerWorker::OnCharacterListReceived() {
             ItemLocation location;
             location.set_type(ItemLocationType::CHARACTER);
             location.set_character(name);
-            QueueRequest(MakeCharacterRequest(name, location), location);
+            characters.insert(location.GetUniqueHash());
+            // Already done before the refresh was interrupted
+            if (!received_items_.count(location))
+                QueueRequest(MakeCharacterRequest(name, location), location);
+        }
+    }
+    // Characters from the checkpoint that have been deleted since
+    for (auto it = received_items_.begin(); it != received_items_.end();) {
+        if (it->first.get_type() != ItemLocationType::CHARACTER || characters.count(it->first.GetUniqueHash())) {
+            ++it;
+            continue;
         }
+        --total_completed_;
+        --total_needed_;
+        DropCompleted(it->first);
+        it = received_items_.erase(it);
     }
     CurrentStatusUpdate status;
     status.state = ProgramState::CharactersReceived;
@@ -195,24 +340,12 @@ void ItemsManagerWorker::OnCharacterListReceived() {
     emit StatusUpdate(status);
 
     if (char_count == 0) {
-        updating_ = false;
+        AbortUpdate();
         return;
     }
 
-    // Fetch a single tab and also request tabs list.  We can fetch any tab here with tabs list
-    // appended, so prefer one that the user has already 'checked'.  Default to index '1' which is
-    // first user visible tab.
-    first_fetch_tab_ = 1;
-    for (auto const &tab : tabs_) {
-        if (bo_manager_.GetRefreshChecked(tab)) {
-            first_fetch_tab_ = tab.get_tab_id();
-            break;
-        }
-    }
-
-    QNetworkReply *first_tab = network_manager_.get(MakeTabRequest(first_fetch_tab_, ItemLocation(), true));
-    connect(first_tab, SIGNAL(finished()), this, SLOT(OnFirstTabReceived()));
-    reply->deleteLater();
+    characters_received_ = true;
+    FetchItems();
 }
 
 QNetworkRequest ItemsManagerWorker::MakeTabRequest(int tab_index, const ItemLocation &location, bool tabs) {
@@ -253,21 +386,93 @@ QNetworkRequest ItemsManagerWorker::Request(QUrl url, const ItemLocation &locati
     return tab_cache_->Request(url, location, flags);
 }
 
+ItemsRequestQueue::Priority ItemsManagerWorker::RequestPriority(const ItemLocation &location) const {
+    if (selected_locations_.count(location.GetUniqueHash()) || bo_manager_.GetRefreshLocked(location))
+        return ItemsRequestQueue::Urgent;
+    if (location.get_type() == ItemLocationType::CHARACTER)
+        return ItemsRequestQueue::Character;
+    if (bo_manager_.GetRefreshChecked(location))
+        return ItemsRequestQueue::Checked;
+    return ItemsRequestQueue::Refill;
+}
+
+std::string ItemsManagerWorker::TabKey(const ItemLocation &location) {
+    // A tab is requested by its index but its items are labelled with its name, both have to match
+    return std::to_string(location.get_tab_id()) + ":" + location.GetUniqueHash();
+}
+
+bool ItemsManagerWorker::IsCurrentTab(const ItemLocation &location) const {
+    if (!tabs_received_ || location.get_type() != ItemLocationType::STASH)
+        return true;
+    return current_tabs_.count(TabKey(location)) > 0;
+}
+
 void ItemsManagerWorker::QueueRequest(const QNetworkRequest &request, const ItemLocation &location) {
     QLOG_DEBUG() << "Queued" << location.GetHeader().c_str();
     ItemsRequest items_request;
     items_request.network_request = request;
     items_request.id = queue_id_++;
     items_request.location = location;
-    queue_.push(items_request);
+    queue_.Push(items_request, RequestPriority(location));
+    ++total_needed_;
+    if (location.get_type() == ItemLocationType::STASH)
+        requested_tabs_.insert(TabKey(location));
 }
 
-void ItemsManagerWorker::FetchItems(int limit) {
+bool ItemsManagerWorker::RetryRequest(const ItemsRequest &request) {
+    ItemsRequest retry = request;
+    ++retry.attempts;
+    if (retry.attempts >= kMaxRequestAttempts)
+        return false;
+    std::uniform_real_distribution<double> jitter(0.0, 1.0);
+    qint64 delay = ItemsRequestQueue::RetryDelay(retry.attempts, jitter(random_));
+    QLOG_DEBUG() << "Retrying" << request.location.GetHeader().c_str() << "in" << delay << "ms";
+    retry.id = queue_id_++;
+    // Retries keep their priority but don't hold up requests that are ready
+    queue_.Push(retry, RequestPriority(retry.location), QDateTime::currentMSecsSinceEpoch() + delay);
+    return true;
+}
+
+void ItemsManagerWorker::FetchItems() {
     std::string tab_titles;
-    int count = std::min(limit, static_cast<int>(queue_.size()));
-    for (int i = 0; i < count; ++i) {
-        ItemsRequest request = queue_.front();
-        queue_.pop();
+    int count = 0;
+    auto cached = [this](const ItemsRequest &request) {
+        return tab_cache_->IsCached(request.network_request.url());
+    };
+    while (!queue_.empty()) {
+        qint64 now = QDateTime::currentMSecsSinceEpoch();
+        qint64 delay = rate_limiter_.Delay(now);
+        ItemsRequest request;
+        // Cached replies never reach the server so they don't count against the limits
+        // and can be taken out of order while the rate limiter makes us wait.
+        bool found = delay > 0 ? queue_.Pop(now, &request, cached) : queue_.Pop(now, &request);
+        if (!found) {
+            // Either the limiter or a retry that isn't due yet is holding us back
+            qint64 wait = std::max(delay, queue_.NextReady() - now);
+            fetch_timer_->start(wait);
+            if (wait > delay) {
+                CurrentStatusUpdate status;
+                status.state = ProgramState::ItemsDeferred;
+                status.progress = total_completed_;
+                status.total = total_needed_;
+                status.cached = total_cached_;
+                status.wait = static_cast<int>((wait + 999) / 1000);
+                status.deferred = queue_.Waiting(now);
+                emit StatusUpdate(status);
+            } else if (delay >= kPausedStatusDelay) {
+                QLOG_DEBUG() << "Sleeping" << delay << "ms to prevent throttling.";
+                CurrentStatusUpdate status;
+                status.state = ProgramState::ItemsPaused;
+                status.progress = total_completed_;
+                status.total = total_needed_;
+                status.cached = total_cached_;
+                status.wait = static_cast<int>((delay + 999) / 1000);
+                emit StatusUpdate(status);
+            }
+            break;
+        }
+        if (!cached(request))
+            rate_limiter_.OnRequestSent(now);
 
         QNetworkReply *fetched = network_manager_.get(request.network_request);
         signal_mapper_->setMapping(fetched, request.id);
@@ -279,27 +484,30 @@ void ItemsManagerWorker::FetchItems(int limit) {
         replies_[request.id] = reply;
 
         tab_titles += request.location.GetHeader() + " ";
+        ++count;
     }
-    QLOG_DEBUG() << "Created" << count << "requests:" << tab_titles.c_str();
-    requests_needed_ = count;
-    requests_completed_ = 0;
-    cached_requests_completed_ = 0;
+    if (count > 0)
+        QLOG_DEBUG() << "Created" << count << "requests:" << tab_titles.c_str();
 }
 
 void ItemsManagerWorker::OnFirstTabReceived() {
     QNetworkReply *reply = qobject_cast<QNetworkReply *>(QObject::sender());
+    if (!IsCurrentReply(reply))
+        return;
+    rate_limiter_.OnReply(reply);
     QByteArray bytes = reply->readAll();
+    reply->deleteLater();
     rapidjson::Document doc;
     doc.Parse(bytes.constData());
 
     if (!doc.IsObject()) {
         QLOG_ERROR() << "Can't even fetch first tab. Failed to update items.";
-        updating_ = false;
+        AbortUpdate();
         return;
     }
     if (!doc.HasMember("tabs") || doc["tabs"].Size() == 0) {
         QLOG_WARN() << "There are no tabs, this should not happen, bailing out.";
-        updating_ = false;
+        AbortUpdate();
         return;
     }
 
@@ -313,40 +521,187 @@ void ItemsManagerWorker::OnFirstTabReceived() {
         std::string label = tab["n"].GetString();
         auto index = tab["i"].GetInt();
         // Ignore hidden locations
-        if (!doc["tabs"][index].HasMember("hidden") || !doc["tabs"][index]["hidden"].GetBool())
+        if (!doc["tabs"][index].HasMember("hidden") || !doc["tabs"][index]["hidden"].GetBool()) {
             tabs_.push_back(ItemLocation(index, label, ItemLocationType::STASH));
+            current_tabs_.insert(TabKey(tabs_.back()));
+        }
+    }
+    tabs_received_ = true;
+
+    // Requests made from the old tabs list for tabs that are gone, were renamed or moved
+    // fetched the wrong thing. Ones still on their way are dropped in OnTabParsed.
+    total_needed_ -= queue_.RemoveIf([this](const ItemsRequest &request) {
+        return !IsCurrentTab(request.location);
+    });
+    for (auto it = received_items_.begin(); it != received_items_.end();) {
+        if (IsCurrentTab(it->first)) {
+            ++it;
+            continue;
+        }
+        --total_completed_;
+        --total_needed_;
+        DropCompleted(it->first);
+        it = received_items_.erase(it);
     }
 
     // Immediately parse items received from this tab (first_fetch_tab_) and Queue requests for the others
     for (auto const &tab: tabs_) {
         auto index = tab.get_tab_id();
         if (index == first_fetch_tab_) {
-            ParseItems(&doc["items"], tab, doc.GetAllocator());
-        } else {
+            // It may have been done before the refresh was interrupted, this is more recent anyway
+            if (!received_items_.count(tab)) {
+                ++total_needed_;
+                ++total_completed_;
+            }
+            Items &items = received_items_[tab];
+            items.clear();
+            ItemParser parser(tab, &items);
+            parser.Parse(bytes);
+            received_hashes_.erase(tab);
+            checkpoint_.Remove(tab);
+        } else if (!requested_tabs_.count(TabKey(tab))) {
             QueueRequest(MakeTabRequest(index, tab), tab);
         }
     }
 
-    total_needed_ = queue_.size() + 1;
-    total_completed_ = 1;
-    total_cached_ = reply->attribute(QNetworkRequest::SourceIsFromCacheAttribute).toBool() ? 1:0;
+    if (reply->attribute(QNetworkRequest::SourceIsFromCacheAttribute).toBool())
+        ++total_cached_;
 
-    FetchItems(kThrottleRequests - 1);
+    FetchItems();
+    if (UpdateCompleted())
+        FinishUpdate();
+}
 
-    connect(signal_mapper_, SIGNAL(mapped(int)), this, SLOT(OnTabReceived(int)));
-    reply->deleteLater();
+std::string ItemsManagerWorker::StorageKey(const ItemLocation &location) {
+    // Same identity as tab_items_ uses, so renaming a tab doesn't leave its old rows behind
+    if (location.get_type() == ItemLocationType::STASH)
+        return "stash:" + std::to_string(location.get_tab_id());
+    return location.GetUniqueHash();
+}
+
+void ItemsManagerWorker::LoadItems(const std::string &key, Items *items) {
+    std::string json = "[";
+    for (auto &record : data_.GetItems(key)) {
+        if (json.size() > 1)
+            json += ",";
+        json += record.json;
+    }
+    json += "]";
+    // All items of a location share the buffer
+    ItemParser parser(ItemLocation(), items);
+    if (!parser.ParseStored(QByteArray::fromStdString(json)))
+        QLOG_ERROR() << "Malformed items data for" << key.c_str() << ", some items may be missing.";
+}
+
+std::vector<ItemRecord> ItemsManagerWorker::ItemRecords(const Items &items) {
+    std::vector<ItemRecord> records;
+    for (auto &item : items)
+        records.push_back({ item->hash(), item->json() });
+    return records;
 }
 
-void ItemsManagerWorker::ParseItems(rapidjson::Value *value_ptr, const ItemLocation &base_location, rapidjson_allocator &alloc) {
-    auto &value = *value_ptr;
-    for (auto &item : value) {
-        ItemLocation location(base_location);
-        location.FromItemJson(item);
-        location.ToItemJson(&item, alloc);
-        items_.push_back(std::make_shared<Item>(item));
-        location.set_socketed(true);
-        ParseItems(&item["socketedItems"], location, alloc);
+bool ItemsManagerWorker::StoreItems(const ItemLocation &location) {
+    auto it = tab_items_.find(location);
+    return data_.SetItems(StorageKey(location), it != tab_items_.end() ? ItemRecords(it->second) : std::vector<ItemRecord>());
+}
+
+void ItemsManagerWorker::StoreUnstored() {
+    // The snapshot doesn't match the items table until it's written again
+    data_.Set(kSnapshotKey, "");
+    for (auto it = unstored_.begin(); it != unstored_.end();) {
+        if (StoreItems(*it))
+            it = unstored_.erase(it);
+        else
+            ++it;
+    }
+    if (!unstored_.empty()) {
+        // Tried again after the next refresh, until then the snapshot stays unused
+        QLOG_ERROR() << "Failed to store the items of" << unstored_.size() << "locations";
+        return;
     }
+    SaveSnapshot();
+}
+
+bool ItemsManagerWorker::LoadSnapshot(Items *items) {
+    std::string generation = data_.Get(kSnapshotKey);
+    if (generation.empty())
+        return false;
+    QFile file(snapshot_file_.c_str());
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+    // Items keep pointing into this for their json
+    QByteArray data = file.readAll();
+    if (!ItemSnapshot::Read(data, generation, items)) {
+        QLOG_WARN() << "Items snapshot is outdated or damaged, loading items from the database";
+        return false;
+    }
+    return true;
+}
+
+void ItemsManagerWorker::SaveSnapshot() {
+    std::string generation = std::to_string(QDateTime::currentMSecsSinceEpoch());
+    QDir().mkpath(QFileInfo(snapshot_file_.c_str()).path());
+    QSaveFile file(snapshot_file_.c_str());
+    if (!file.open(QIODevice::WriteOnly) || file.write(ItemSnapshot::Write(items_, generation)) < 0 || !file.commit()) {
+        QLOG_WARN() << "Failed to write items snapshot to" << snapshot_file_.c_str();
+        return;
+    }
+    data_.Set(kSnapshotKey, generation);
+}
+
+bool ItemsManagerWorker::DiffItems(const Items &previous_items, const Items &received, TabChanges *tab) {
+    // Items are matched by their id, items without one (e.g. created by older versions) by their contents
+    auto key = [](const Item &item) {
+        return item.uid().empty() ? item.raw_json().toStdString() : item.uid();
+    };
+
+    // Same instances as before when the reply didn't change
+    if (received == previous_items) {
+        tab->items = previous_items;
+        return false;
+    }
+
+    std::map<std::string, Items> previous;
+    for (auto &item : previous_items)
+        previous[key(*item)].push_back(item);
+
+    for (auto &item : received) {
+        // Unchanged items of a changed location are replaced by their new instance too: the
+        // previous ones come from the arena of an older reply, it would stay alive with them.
+        tab->items.push_back(item);
+        auto it = previous.find(key(*item));
+        if (it == previous.end() || it->second.empty()) {
+            tab->added.push_back(item);
+            continue;
+        }
+        auto old = it->second.back();
+        it->second.pop_back();
+        // Tabs can be renamed, which changes the location of every item in them
+        if (old->raw_json() != item->raw_json()
+                || old->location().GetUniqueHash() != item->location().GetUniqueHash())
+            tab->modified.push_back(std::make_pair(old, item));
+    }
+    for (auto &pair : previous)
+        tab->removed.insert(tab->removed.end(), pair.second.begin(), pair.second.end());
+    if (tab->added.empty() && tab->removed.empty() && tab->modified.empty()) {
+        // Same items in another order, the previous instances are what the rest of the application has
+        tab->items = previous_items;
+        return false;
+    }
+
+    // Present the tab in a deterministic order no matter how the items were moved around
+    std::sort(begin(tab->items), end(tab->items), [](const std::shared_ptr<Item> &a, const std::shared_ptr<Item> &b){
+        return *a < *b;
+    });
+    return true;
+}
+
+void ItemsManagerWorker::DiffTab(const ItemLocation &location, const Items &received, ItemsChangeSet *changes) {
+    TabChanges tab;
+    bool changed = DiffItems(tab_items_[location], received, &tab);
+    tab_items_[location] = tab.items;
+    if (changed)
+        (*changes)[location] = std::move(tab);
 }
 
 void ItemsManagerWorker::OnTabReceived(int request_id) {
@@ -356,112 +711,211 @@ void ItemsManagerWorker::OnTabReceived(int request_id) {
     }
 
     ItemsReply reply = replies_[request_id];
+    replies_.erase(request_id);
+    rate_limiter_.OnReply(reply.network_reply);
 
     bool cache_status = reply.network_reply->attribute(QNetworkRequest::SourceIsFromCacheAttribute).toBool();
 
     if (cache_status) {
         QLOG_DEBUG() << "Received a cached reply for" << reply.request.location.GetHeader().c_str();
-        ++cached_requests_completed_;
         ++total_cached_;
     } else {
         QLOG_DEBUG() << "Received a reply for" << reply.request.location.GetHeader().c_str();
     }
 
     QByteArray bytes = reply.network_reply->readAll();
-    rapidjson::Document doc;
-    doc.Parse(bytes.constData());
+    reply.network_reply->deleteLater();
 
-    bool error = false;
-    if (!doc.IsObject()) {
-        QLOG_WARN() << request_id << "got a non-object response";
-        error = true;
-    } else if (doc.HasMember("error")) {
+    // Parsing and creating items is what takes most of the time, so it's done in the
+    // thread pool and several tabs are processed at once. The results are collected
+    // back on this thread in OnTabParsed.
+    ItemsRequest request = reply.request;
+    quint64 previous_hash = 0;
+    auto it = reply_hashes_.find(request.location);
+    if (it != reply_hashes_.end() && tab_items_.count(request.location))
+        previous_hash = it->second;
+    auto watcher = new QFutureWatcher<ItemsParseResult>(this);
+    int update_id = update_id_;
+    connect(watcher, &QFutureWatcher<ItemsParseResult>::finished, this, [this, watcher, request, update_id]() {
+        if (update_id == update_id_)
+            OnTabParsed(request, watcher->result());
+        watcher->deleteLater();
+    });
+    watcher->setFuture(QtConcurrent::run(&ItemsManagerWorker::ParseTab, bytes, request.location, previous_hash));
+}
+
+ItemsParseResult ItemsManagerWorker::ParseTab(const QByteArray &bytes, const ItemLocation &location, quint64 previous_hash) {
+    ItemsParseResult result;
+    // Most tabs don't change between refreshes, there's no need to build their items again.
+    // A renamed tab gets the same reply but its items need the new location.
+    std::string key = location.GetUniqueHash();
+    result.hash = Util::FastHash(bytes.constData(), bytes.size()) ^ Util::FastHash(key.c_str(), key.size());
+    if (previous_hash != 0 && result.hash == previous_hash) {
+        result.unchanged = true;
+        return result;
+    }
+
+    // Stash tabs can be big, items are built as the reply is read instead of going through a DOM
+    ItemParser parser(location, &result.items);
+
+    if (!parser.Parse(bytes)) {
+        QLOG_WARN() << location.GetHeader().c_str() << "got a non-object response";
+        result.error = true;
+        result.items.clear();
+    } else if (parser.error()) {
         // this can happen if user is browsing stash in background and we can't know about it
-        QLOG_WARN() << request_id << "got 'error' instead of stash tab contents";
-        error = true;
+        QLOG_WARN() << location.GetHeader().c_str() << "got 'error' instead of stash tab contents";
+        result.error = true;
+        result.items.clear();
     }
+    return result;
+}
 
+void ItemsManagerWorker::OnTabParsed(const ItemsRequest &request, const ItemsParseResult &result) {
     // re-queue a failed request
-    if (error) {
+    bool retrying = false;
+    if (!IsCurrentTab(request.location)) {
+        QLOG_DEBUG() << "Dropping the reply for" << request.location.GetHeader().c_str()
+            << "which was requested before the tabs list arrived, the tab has changed";
+        --total_needed_;
+    } else if (result.error) {
         // We can 'cache' error response document so make sure we remove it
         // before reque
-        tab_cache_->remove(reply.request.network_request.url());
-        QueueRequest(reply.request.network_request, reply.request.location);
-    }
-
-    ++requests_completed_;
-
-    if (!error)
-        ++total_completed_;
-
-    bool throttled = false;
-    if (requests_completed_ == requests_needed_ && queue_.size() > 0) {
-        if (cached_requests_completed_ > 0) {
-            // We basically don't want cached requests to count against throttle limit
-            // so if we did get any cached requests fetch up to that number without a
-            // large delay
-            QTimer::singleShot(1, [&]() { FetchItems(cached_requests_completed_); });
-        } else {
-            throttled = true;
-            QLOG_DEBUG() << "Sleeping one minute to prevent throttling.";
-            QTimer::singleShot(kThrottleSleep * 1000, this, SLOT(FetchItems()));
+        tab_cache_->remove(request.network_request.url());
+        retrying = RetryRequest(request);
+        if (!retrying) {
+            QLOG_WARN() << "Giving up on" << request.location.GetHeader().c_str() << "after"
+                << kMaxRequestAttempts << "attempts, keeping the items we had for it";
+            ++total_completed_;
+            auto it = tab_items_.find(request.location);
+            received_items_[request.location] = it != tab_items_.end() ? it->second : Items();
         }
+    } else {
+        ++total_completed_;
+        auto it = tab_items_.find(request.location);
+        bool reused = result.unchanged && it != tab_items_.end();
+        received_items_[request.location] = reused ? it->second : result.items;
+        received_hashes_[request.location] = result.hash;
+        if (reused)
+            checkpoint_.Add(request.location, result.hash);
+        else
+            checkpoint_.Remove(request.location);
     }
+
     CurrentStatusUpdate status = CurrentStatusUpdate();
-    status.state = throttled ? ProgramState::ItemsPaused : ProgramState::ItemsReceive;
+    status.state = ProgramState::ItemsReceive;
     status.progress = total_completed_;
     status.total = total_needed_;
     status.cached = total_cached_;
-    if (total_completed_ == total_needed_)
+    if (UpdateCompleted())
         status.state = ProgramState::ItemsCompleted;
     emit StatusUpdate(status);
 
-    if (error)
-        return;
+    // Sending a request may have been put off by the rate limiter or by a
+    // request that failed and had to be queued again
+    if (queue_.size() > 0)
+        FetchItems();
 
-    ParseItems(&doc["items"], reply.request.location, doc.GetAllocator());
-
-    if (total_completed_ == total_needed_) {
-        // It's possible that we receive character vs stash tabs out of order, or users
-        // move items around in a tab and we get them in a different order. For
-        // consistency we want to present the tab data in a deterministic way to the rest
-        // of the application.  Especially so we don't try to update shop when nothing actually
-        // changed.  So sort items_ here before emitting and then generate
-        // item list as strings.
+    if (!retrying && UpdateCompleted())
+        FinishUpdate();
+}
 
-        std::sort(begin(items_), end(items_), [](const std::shared_ptr<Item> &a, const std::shared_ptr<Item> &b){
-            return *a < *b;
-        });
+bool ItemsManagerWorker::UpdateCompleted() const {
+    return main_page_received_ && characters_received_ && tabs_received_ && total_completed_ == total_needed_;
+}
 
-        QStringList tmp;
-        for (auto const &item: items_) {
-            tmp.push_back(item->json().c_str());
+void ItemsManagerWorker::FinishUpdate() {
+    // Only pass on what actually changed so that the rest of the application doesn't
+    // have to go through every item when a single tab was refreshed.
+    ItemsChangeSet changes;
+    for (auto &pair : received_items_)
+        DiffTab(pair.first, pair.second, &changes);
+
+    // Tabs and characters that we didn't get this time are gone
+    for (auto it = tab_items_.begin(); it != tab_items_.end();) {
+        if (received_items_.count(it->first)) {
+            ++it;
+            continue;
         }
-        auto items_as_string = std::string("[") + tmp.join(",").toStdString() + "]";
+        if (!it->second.empty())
+            changes[it->first].removed = it->second;
+        reply_hashes_.erase(it->first);
+        it = tab_items_.erase(it);
+    }
+    // The first tab comes with the tabs list, its reply isn't worth remembering
+    for (auto &pair : received_items_) {
+        auto it = received_hashes_.find(pair.first);
+        if (it != received_hashes_.end())
+            reply_hashes_[pair.first] = it->second;
+        else
+            reply_hashes_.erase(pair.first);
+    }
+    received_items_.clear();
+    received_hashes_.clear();
 
-        // all requests completed
-        emit ItemsRefreshed(items_, tabs_, false);
+    // It's possible that we receive character vs stash tabs out of order, so items_ is
+    // rebuilt in the order of locations for consistency.
+    items_.clear();
+    for (auto &pair : tab_items_)
+        items_.insert(items_.end(), pair.second.begin(), pair.second.end());
+
+    // all requests completed
+    emit ItemsRefreshed(items_, tabs_, changes, false);
+
+    // DataStore is thread safe so it's ok to call it here. Only the locations that
+    // changed are written, the ones that are gone end up with no rows.
+    for (auto &pair : changes)
+        unstored_.insert(pair.first);
+    if (!unstored_.empty())
+        StoreUnstored();
+    data_.Set("tabs", tabs_as_string_);
+    checkpoint_.Clear();
+    rate_limiter_.Save();
+
+    updating_ = false;
+    QLOG_DEBUG() << "Finished updating stash," << ItemArena::live_count() << "item arenas alive.";
+
+    // if we're at the verge of getting throttled, sleep so we don't
+    QTimer::singleShot(rate_limiter_.Delay(QDateTime::currentMSecsSinceEpoch()), this, SLOT(PreserveSelectedCharacter()));
+}
 
-        // DataStore is thread safe so it's ok to call it here
-        data_.Set("items", items_as_string);
-        data_.Set("tabs", tabs_as_string_);
+void ItemsManagerWorker::DropCompleted(const ItemLocation &location) {
+    received_hashes_.erase(location);
+    checkpoint_.Remove(location);
+}
 
-        updating_ = false;
-        QLOG_DEBUG() << "Finished updating stash.";
+void ItemsManagerWorker::LoadCheckpoint(TabCache::Policy policy) {
+    if (!checkpoint_.Start(policy, QDateTime::currentMSecsSinceEpoch()))
+        return;
 
-        // if we're at the verge of getting throttled, sleep so we don't
-        if (requests_completed_ == kThrottleRequests)
-            QTimer::singleShot(kThrottleSleep, this, SLOT(PreserveSelectedCharacter()));
-        else
-            PreserveSelectedCharacter();
+    std::vector<ItemLocation> gone;
+    for (auto &pair : checkpoint_.locations()) {
+        const ItemLocation &location = pair.first;
+        // Locations in the checkpoint didn't change, so their items are the ones we have
+        auto previous = tab_items_.find(location);
+        if (previous == tab_items_.end()) {
+            // Should not happen, it will simply be fetched again
+            gone.push_back(location);
+            continue;
+        }
+        received_items_[location] = previous->second;
+        if (pair.second != 0)
+            received_hashes_[location] = pair.second;
+        if (location.get_type() == ItemLocationType::STASH)
+            requested_tabs_.insert(TabKey(location));
+        ++total_needed_;
+        ++total_completed_;
     }
-
-    reply.network_reply->deleteLater();
+    for (auto &location : gone)
+        checkpoint_.Remove(location);
+    if (!received_items_.empty())
+        QLOG_INFO() << "Resuming the refresh," << received_items_.size() << "locations are already done";
 }
 
 void ItemsManagerWorker::PreserveSelectedCharacter() {
     if (selected_character_.empty())
         return;
     tab_cache_->OnPolicyUpdate(TabCache::DefaultCache);
+    rate_limiter_.OnRequestSent(QDateTime::currentMSecsSinceEpoch());
     network_manager_.get(MakeCharacterRequest(selected_character_, ItemLocation()));
 }
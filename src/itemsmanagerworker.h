@@ -19,42 +19,55 @@
 
 #pragma once
 
-#include <queue>
+#include <random>
+#include <set>
+#include <QFutureWatcher>
 #include <QNetworkAccessManager>
 #include <QNetworkRequest>
 #include <QObject>
 
 #include "item.h"
+#include "itemsrequestqueue.h"
 #include "mainwindow.h"
+#include "ratelimiter.h"
+#include "refreshcheckpoint.h"
 
 class Application;
 class DataStore;
+struct ItemRecord;
 class QNetworkReply;
 class QSignalMapper;
 class QTimer;
 class BuyoutManager;
 class TabCache;
 
-const int kThrottleRequests = 45;
-const int kThrottleSleep = 60;
 const int kMaxCacheSize = (10*1024*1024); // 10MB
 
-struct ItemsRequest {
-    int id;
-    QNetworkRequest network_request;
-    ItemLocation location;
-};
-
 struct ItemsReply {
     QNetworkReply *network_reply;
     ItemsRequest request;
 };
 
+struct ItemsParseResult {
+    bool error{false};
+    Items items;
+    // hash of the reply and the location it was received for
+    quint64 hash{};
+    // the reply is the same as the last time, items weren't built
+    bool unchanged{false};
+};
+
 class ItemsManagerWorker : public QObject {
     Q_OBJECT
 public:
     ItemsManagerWorker(Application &app, QThread *thread);
     ~ItemsManagerWorker();
+    /*
+    * Compares the items received for a location with the ones we had before. Fills `tab`
+    * and returns true if anything changed. The items of a changed location are all taken
+    * from `received`, so that nothing keeps the arena of the previous ones alive.
+    */
+    static bool DiffItems(const Items &previous, const Items &received, TabChanges *tab);
 public slots:
     void Init();
     void Update(TabCache::Policy policy, const std::vector<ItemLocation> &tab_names = std::vector<ItemLocation>());
@@ -64,43 +77,102 @@ public slots:
     void OnFirstTabReceived();
     void OnTabReceived(int index);
     /*
-    * Makes 45 requests at once, should be called every minute.
-    * These values are approximated (GGG throttles requests)
-    * based on some quick testing.
+    * Sends queued requests as long as the rate limiter allows it,
+    * then schedules itself for the moment the next one can be sent.
+    * Requests that will be served from the cache are never delayed.
     */
-    void FetchItems(int limit = kThrottleRequests);
+    void FetchItems();
     void PreserveSelectedCharacter();
 signals:
-    void ItemsRefreshed(const Items &items, const std::vector<ItemLocation> &tabs, bool initial_refresh);
+    void ItemsRefreshed(const Items &items, const std::vector<ItemLocation> &tabs, const ItemsChangeSet &changes, bool initial_refresh);
     void StatusUpdate(const CurrentStatusUpdate &status);
 private:
 
     QNetworkRequest MakeTabRequest(int tab_index, const ItemLocation &location, bool tabs = false);
     QNetworkRequest MakeCharacterRequest(const std::string &name, const ItemLocation &location);
+    // Drops a reply to a request made by an earlier refresh, returns false for those
+    bool IsCurrentReply(QNetworkReply *reply) const;
+    void AbortUpdate();
+    bool UpdateCompleted() const;
+    // Works out what changed once every request is done and passes it on
+    void FinishUpdate();
+    static std::string TabKey(const ItemLocation &location);
+    // False for tabs that are not in the tabs list received during this refresh
+    bool IsCurrentTab(const ItemLocation &location) const;
     void QueueRequest(const QNetworkRequest &request, const ItemLocation &location);
-    void ParseItems(rapidjson::Value *value_ptr, const ItemLocation &base_location, rapidjson_allocator &alloc);
+    // Queues a failed request again after a backoff, returns false once it has failed too many times
+    bool RetryRequest(const ItemsRequest &request);
+    ItemsRequestQueue::Priority RequestPriority(const ItemLocation &location) const;
+    // Runs in the thread pool, must not touch any members.
+    // `previous_hash` is the hash of the last reply for the location whose items we have, 0 if none.
+    static ItemsParseResult ParseTab(const QByteArray &bytes, const ItemLocation &location, quint64 previous_hash);
+    void OnTabParsed(const ItemsRequest &request, const ItemsParseResult &result);
+    // Records the differences of a location in `changes` and takes its received items
+    void DiffTab(const ItemLocation &location, const Items &received, ItemsChangeSet *changes);
+    // Key of the location's rows in the items table
+    static std::string StorageKey(const ItemLocation &location);
+    static std::vector<ItemRecord> ItemRecords(const Items &items);
+    void LoadItems(const std::string &key, Items *items);
+    // Replaces the stored items of the location with the ones in tab_items_,
+    // returns false if the DataStore failed to.
+    bool StoreItems(const ItemLocation &location);
+    // Stores the items of unstored_, then the snapshot if they all made it
+    void StoreUnstored();
+    bool LoadSnapshot(Items *items);
+    // Writes items_ to the snapshot file, only call when the items table is up to date
+    void SaveSnapshot();
+    // Forgets a location which turned out to be gone
+    void DropCompleted(const ItemLocation &location);
+    // Restores the locations of a checkpoint this refresh resumes into received_items_,
+    // the rest of the requests are made again from the character and tabs lists.
+    void LoadCheckpoint(TabCache::Policy policy);
 
     QNetworkRequest Request(QUrl url, const ItemLocation &location, TabCache::Flags flags = TabCache::None);
     DataStore &data_;
+    RateLimiter rate_limiter_;
+    RefreshCheckpoint checkpoint_;
+    QTimer *fetch_timer_;
     QNetworkAccessManager network_manager_;
     QSignalMapper *signal_mapper_;
     std::vector<ItemLocation> tabs_;
-    std::queue<ItemsRequest> queue_;
+    ItemsRequestQueue queue_;
+    // Locations the user asked to refresh, by their unique hash
+    std::set<std::string> selected_locations_;
     std::map<int, ItemsReply> replies_;
     Items items_;
+    // items_ grouped by location, kept between refreshes so that they can be diffed
+    std::map<ItemLocation, Items> tab_items_;
+    // items received during the current refresh
+    std::map<ItemLocation, Items> received_items_;
+    // Hashes of the replies the items in tab_items_ were built from
+    std::map<ItemLocation, quint64> reply_hashes_;
+    // and the ones received during the current refresh
+    std::map<ItemLocation, quint64> received_hashes_;
     int total_completed_, total_needed_, total_cached_;
-    int requests_completed_, requests_needed_;
-    int cached_requests_completed_{0};
     
     std::string tabs_as_string_;
     std::string league_;
     // set to true if updating right now
     bool updating_;
     int queue_id_;
+    // Incremented by every refresh, replies to requests made by an earlier one are ignored
+    int update_id_{0};
+    bool characters_received_{false}, tabs_received_{false};
+    // The update isn't over until the selected character is known, see PreserveSelectedCharacter
+    bool main_page_received_{false};
+    // TabKey of the tabs requested during this refresh
+    std::set<std::string> requested_tabs_;
+    // TabKey of the tabs in the tabs list, once it's received
+    std::set<std::string> current_tabs_;
+    // Locations whose items changed but aren't in the items table yet
+    std::set<ItemLocation> unstored_;
     std::string selected_character_;
 
     int first_fetch_tab_{1};
     TabCache *tab_cache_{new TabCache()};
     const BuyoutManager &bo_manager_;
     std::string account_name_;
+    std::string snapshot_file_;
+    // jitter for retries
+    std::mt19937 random_;
 };
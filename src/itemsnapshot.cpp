@@ -0,0 +1,437 @@
+/*
+    Copyright 2016 Ilya Zhuravlev
+
+    This file is part of Acquisition.
+
+    Acquisition is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Acquisition is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Acquisition.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "itemsnapshot.h"
+
+#include <cstring>
+#include <QtEndian>
+
+#include "QsLog.h"
+
+#include "geartypelist.h"
+#include "itemarena.h"
+#include "modlist.h"
+
+namespace {
+
+const char kMagic[] = "ACQI";
+
+// Everything is little endian, strings are a length followed by the bytes
+class SnapshotWriter {
+public:
+    explicit SnapshotWriter(QByteArray *output) : output_(output) {}
+    void UInt(quint32 value) {
+        uchar bytes[sizeof(value)];
+        qToLittleEndian(value, bytes);
+        output_->append(reinterpret_cast<const char*>(bytes), sizeof(bytes));
+    }
+    void Int(qint32 value) { UInt(static_cast<quint32>(value)); }
+    void Bool(bool value) { output_->append(value ? 1 : 0); }
+    void UInt64(quint64 value) {
+        uchar bytes[sizeof(value)];
+        qToLittleEndian(value, bytes);
+        output_->append(reinterpret_cast<const char*>(bytes), sizeof(bytes));
+    }
+    void Double(double value) {
+        quint64 bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        UInt64(bits);
+    }
+    void String(const char *data, int size) {
+        UInt(size);
+        output_->append(data, size);
+    }
+    void String(const std::string &value) { String(value.c_str(), value.size()); }
+private:
+    QByteArray *output_;
+};
+
+// Reads past the end of the data don't crash, they make the whole read fail
+class SnapshotReader {
+public:
+    explicit SnapshotReader(const QByteArray &data) :
+        data_(data.constData()),
+        size_(data.size()),
+        position_(0),
+        ok_(true)
+    {}
+    bool ok() const { return ok_; }
+    int position() const { return position_; }
+    quint32 UInt() {
+        if (!Ensure(sizeof(quint32)))
+            return 0;
+        quint32 value = qFromLittleEndian<quint32>(reinterpret_cast<const uchar*>(data_ + position_));
+        position_ += sizeof(value);
+        return value;
+    }
+    qint32 Int() { return static_cast<qint32>(UInt()); }
+    bool Bool() {
+        if (!Ensure(1))
+            return false;
+        return data_[position_++] != 0;
+    }
+    quint64 UInt64() {
+        if (!Ensure(sizeof(quint64)))
+            return 0;
+        quint64 value = qFromLittleEndian<quint64>(reinterpret_cast<const uchar*>(data_ + position_));
+        position_ += sizeof(value);
+        return value;
+    }
+    double Double() {
+        quint64 bits = UInt64();
+        double value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+    // Skips over a string, returning where its bytes start
+    int Skip(int *size) {
+        *size = UInt();
+        if (!Ensure(*size))
+            return 0;
+        int start = position_;
+        position_ += *size;
+        return start;
+    }
+    std::string String() {
+        int size;
+        int start = Skip(&size);
+        return ok_ ? std::string(data_ + start, size) : std::string();
+    }
+    // Makes the whole read fail, for data that can't be right
+    void Fail() { ok_ = false; }
+private:
+    bool Ensure(quint32 size) {
+        if (!ok_ || size > static_cast<quint32>(size_ - position_))
+            ok_ = false;
+        return ok_;
+    }
+
+    const char *data_;
+    int size_;
+    int position_;
+    bool ok_;
+};
+
+// Mod tables store ids, the snapshot is only usable with the same names behind them
+void WriteNames(SnapshotWriter *out, const ModNames &names) {
+    out->UInt(names.size());
+    out->UInt64(names.Fingerprint());
+}
+
+bool ReadNames(SnapshotReader *in, const ModNames &names) {
+    quint32 size = in->UInt();
+    return size == names.size() && in->UInt64() == names.Fingerprint() && in->ok();
+}
+
+} // namespace
+
+class ItemSnapshotAccess {
+public:
+    static void Write(SnapshotWriter *out, const ItemLocation &location) {
+        out->Int(static_cast<int>(location.type_));
+        out->Int(location.tab_id_);
+        out->String(location.tab_label_);
+        out->String(location.character_);
+        out->Bool(location.socketed_);
+        out->Int(location.x_);
+        out->Int(location.y_);
+        out->Int(location.w_);
+        out->Int(location.h_);
+        out->String(location.inventory_id_);
+    }
+
+    static void Read(SnapshotReader *in, ItemLocation *location) {
+        location->type_ = static_cast<ItemLocationType>(in->Int());
+        location->tab_id_ = in->Int();
+        location->tab_label_ = in->String();
+        location->character_ = in->String();
+        location->socketed_ = in->Bool();
+        location->x_ = in->Int();
+        location->y_ = in->Int();
+        location->w_ = in->Int();
+        location->h_ = in->Int();
+        location->inventory_id_ = in->String();
+    }
+
+    static void Write(SnapshotWriter *out, const Item &item) {
+        out->String(item.name_);
+        Write(out, item.location_);
+        out->String(item.typeLine_);
+        out->Bool(item.corrupted_);
+        out->Bool(item.identified_);
+        out->Int(item.w_);
+        out->Int(item.h_);
+        out->Int(item.frameType_);
+        out->String(item.icon_);
+        out->UInt(item.properties_.size());
+        for (auto &pair : item.properties_) {
+            out->String(pair.first);
+            out->String(pair.second);
+        }
+        out->String(item.old_hash_);
+        out->String(item.hash_);
+        out->UInt(item.elemental_damage_.size());
+        for (auto &pair : item.elemental_damage_) {
+            out->String(pair.first);
+            out->Int(pair.second);
+        }
+        out->Int(item.sockets_cnt_);
+        out->Int(item.links_cnt_);
+        Write(out, item.sockets_);
+        out->UInt(item.socket_groups_.size());
+        for (auto &group : item.socket_groups_)
+            Write(out, group);
+        out->UInt(item.requirements_.size());
+        for (auto &pair : item.requirements_) {
+            out->String(pair.first);
+            out->Int(pair.second);
+        }
+        QByteArray json = item.raw_json();
+        out->String(json.constData(), json.size());
+        out->Int(item.count_);
+        out->Bool(item.has_mtx_);
+        out->Int(item.ilvl_);
+        out->UInt(item.text_properties_.size());
+        for (auto &property : item.text_properties_) {
+            out->String(property.name);
+            out->UInt(property.values.size());
+            for (auto &value : property.values)
+                Write(out, value);
+            out->Int(property.display_mode);
+        }
+        out->UInt(item.text_requirements_.size());
+        for (auto &requirement : item.text_requirements_) {
+            out->String(requirement.name);
+            Write(out, requirement.value);
+        }
+        out->UInt(item.text_mods_.size());
+        for (auto &pair : item.text_mods_) {
+            out->String(pair.first);
+            out->UInt(pair.second.size());
+            for (auto &mod : pair.second)
+                out->String(mod);
+        }
+        out->UInt(item.text_sockets_.size());
+        for (auto &socket : item.text_sockets_) {
+            out->Int(socket.group);
+            out->Int(socket.attr);
+        }
+        out->String(item.note_);
+        Write(out, item.mod_table_);
+        Write(out, item.gear_table_);
+        out->String(item.uid_);
+    }
+
+    static std::shared_ptr<Item> Read(SnapshotReader *in, const QByteArray &data, const std::shared_ptr<ItemArena> &arena) {
+        std::shared_ptr<Item> result = ItemArena::NewItem(arena);
+        Item &item = *result;
+        item.name_ = in->String();
+        Read(in, &item.location_);
+        item.typeLine_ = in->String();
+        item.corrupted_ = in->Bool();
+        item.identified_ = in->Bool();
+        item.w_ = in->Int();
+        item.h_ = in->Int();
+        item.frameType_ = in->Int();
+        item.icon_ = in->String();
+        for (quint32 i = 0, size = in->UInt(); i < size && in->ok(); ++i) {
+            std::string name = in->String();
+            item.properties_[name] = in->String();
+        }
+        item.old_hash_ = in->String();
+        item.hash_ = in->String();
+        for (quint32 i = 0, size = in->UInt(); i < size && in->ok(); ++i) {
+            std::string damage = in->String();
+            item.elemental_damage_.push_back(std::make_pair(damage, in->Int()));
+        }
+        item.sockets_cnt_ = in->Int();
+        item.links_cnt_ = in->Int();
+        Read(in, &item.sockets_);
+        for (quint32 i = 0, size = in->UInt(); i < size && in->ok(); ++i) {
+            ItemSocketGroup group;
+            Read(in, &group);
+            item.socket_groups_.push_back(group);
+        }
+        for (quint32 i = 0, size = in->UInt(); i < size && in->ok(); ++i) {
+            std::string name = in->String();
+            item.requirements_[name] = in->Int();
+        }
+        int json_size;
+        item.json_offset_ = in->Skip(&json_size);
+        item.json_size_ = json_size;
+        // Until CopyJson gives the items of the location a buffer of their own
+        item.json_source_ = data;
+        item.count_ = in->Int();
+        item.has_mtx_ = in->Bool();
+        item.ilvl_ = in->Int();
+        for (quint32 i = 0, size = in->UInt(); i < size && in->ok(); ++i) {
+            ItemProperty property;
+            property.name = in->String();
+            for (quint32 j = 0, values = in->UInt(); j < values && in->ok(); ++j) {
+                ItemPropertyValue value;
+                Read(in, &value);
+                property.values.push_back(value);
+            }
+            property.display_mode = in->Int();
+            item.text_properties_.push_back(property);
+        }
+        for (quint32 i = 0, size = in->UInt(); i < size && in->ok(); ++i) {
+            ItemRequirement requirement;
+            requirement.name = in->String();
+            Read(in, &requirement.value);
+            item.text_requirements_.push_back(requirement);
+        }
+        for (quint32 i = 0, size = in->UInt(); i < size && in->ok(); ++i) {
+            std::string type = in->String();
+            auto &mods = item.text_mods_[type];
+            mods.clear();
+            for (quint32 j = 0, count = in->UInt(); j < count && in->ok(); ++j)
+                mods.push_back(in->String());
+        }
+        for (quint32 i = 0, size = in->UInt(); i < size && in->ok(); ++i) {
+            ItemSocket socket;
+            socket.group = static_cast<unsigned char>(in->Int());
+            socket.attr = static_cast<char>(in->Int());
+            item.text_sockets_.push_back(socket);
+        }
+        item.note_ = in->String();
+        Read(in, &item.mod_table_, mod_names);
+        Read(in, &item.gear_table_, gear_names);
+        item.uid_ = in->String();
+        return result;
+    }
+
+    // Copies the json of the items into one buffer for all of them, so that they
+    // don't keep the whole snapshot in memory once the other locations are gone.
+    static void CopyJson(Items::const_iterator begin, Items::const_iterator end) {
+        int size = 0;
+        for (auto it = begin; it != end; ++it)
+            size += (*it)->json_size_;
+        QByteArray json;
+        json.reserve(size);
+        std::vector<int> offsets;
+        for (auto it = begin; it != end; ++it) {
+            const Item &item = **it;
+            offsets.push_back(json.size());
+            json.append(item.json_source_.constData() + item.json_offset_, item.json_size_);
+        }
+        auto offset = offsets.begin();
+        for (auto it = begin; it != end; ++it, ++offset) {
+            (*it)->json_source_ = json;
+            (*it)->json_offset_ = *offset;
+        }
+    }
+
+private:
+    static void Write(SnapshotWriter *out, const ItemSocketGroup &group) {
+        out->Int(group.r);
+        out->Int(group.g);
+        out->Int(group.b);
+        out->Int(group.w);
+    }
+
+    static void Read(SnapshotReader *in, ItemSocketGroup *group) {
+        group->r = in->Int();
+        group->g = in->Int();
+        group->b = in->Int();
+        group->w = in->Int();
+    }
+
+    static void Write(SnapshotWriter *out, const ItemPropertyValue &value) {
+        out->String(value.str);
+        out->Int(value.type);
+    }
+
+    static void Read(SnapshotReader *in, ItemPropertyValue *value) {
+        value->str = in->String();
+        value->type = in->Int();
+    }
+
+    // The ids are checked against the names when the snapshot is read, see WriteNames
+    static void Write(SnapshotWriter *out, const ModTable &table) {
+        out->UInt(table.size());
+        for (auto &entry : table) {
+            out->Int(entry.id);
+            out->Double(entry.value);
+        }
+    }
+
+    static void Read(SnapshotReader *in, ModTable *table, const ModNames &names) {
+        for (quint32 i = 0, size = in->UInt(); i < size && in->ok(); ++i) {
+            int id = in->Int();
+            if (id < 0 || static_cast<size_t>(id) >= names.size()) {
+                in->Fail();
+                return;
+            }
+            table->Add(id, in->Double());
+        }
+    }
+};
+
+QByteArray ItemSnapshot::Write(const Items &items, const std::string &generation) {
+    QByteArray result;
+    SnapshotWriter out(&result);
+    result.append(kMagic, 4);
+    out.UInt(kVersion);
+    out.String(generation);
+    WriteNames(&out, mod_names);
+    WriteNames(&out, gear_names);
+    // Items are grouped by location, each group is read into an arena of its own
+    std::vector<std::pair<size_t, size_t>> groups;
+    for (size_t i = 0; i < items.size(); ++i) {
+        if (groups.empty() || items[groups.back().first]->location() < items[i]->location()
+                || items[i]->location() < items[groups.back().first]->location())
+            groups.push_back(std::make_pair(i, 0));
+        ++groups.back().second;
+    }
+    out.UInt(groups.size());
+    for (auto &group : groups) {
+        out.UInt(group.second);
+        for (size_t i = group.first; i < group.first + group.second; ++i)
+            ItemSnapshotAccess::Write(&out, *items[i]);
+    }
+    return result;
+}
+
+bool ItemSnapshot::Read(const QByteArray &data, const std::string &generation, Items *items) {
+    if (!data.startsWith(kMagic))
+        return false;
+    SnapshotReader in(data);
+    in.UInt();
+    if (in.UInt() != kVersion || in.String() != generation)
+        return false;
+    if (!ReadNames(&in, mod_names) || !ReadNames(&in, gear_names)) {
+        QLOG_WARN() << "The items snapshot was written with another mod list";
+        return false;
+    }
+
+    Items result;
+    for (quint32 group = 0, groups = in.UInt(); group < groups && in.ok(); ++group) {
+        auto arena = std::make_shared<ItemArena>();
+        size_t first = result.size();
+        for (quint32 i = 0, size = in.UInt(); i < size && in.ok(); ++i)
+            result.push_back(ItemSnapshotAccess::Read(&in, data, arena));
+        if (in.ok())
+            ItemSnapshotAccess::CopyJson(result.begin() + first, result.end());
+    }
+    if (!in.ok() || in.position() != data.size())
+        return false;
+    items->insert(items->end(), result.begin(), result.end());
+    return true;
+}
@@ -0,0 +1,47 @@
+/*
+    Copyright 2016 Ilya Zhuravlev
+
+    This file is part of Acquisition.
+
+    Acquisition is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Acquisition is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Acquisition.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <string>
+#include <QByteArray>
+#include <QtGlobal>
+
+#include "item.h"
+
+/*
+ * ItemSnapshot is a binary dump of fully parsed items: everything Item derives
+ * from its json (hashes, sockets, mod tables, ...) is stored as is, so loading
+ * it at startup doesn't involve parsing json, hashing or generating mods.
+ *
+ * The items table stays the source of truth, the snapshot is only used if its
+ * generation matches the one saved along with the items.
+ */
+class ItemSnapshot {
+public:
+    // Bump whenever Item's fields or the way they are derived change. A change of the
+    // mod list is noticed on its own.
+    static const quint32 kVersion = 4;
+
+    static QByteArray Write(const Items &items, const std::string &generation);
+    // Returns false if the data is malformed, from another version, of another generation
+    // or written with another mod list.
+    // The json of the items of each location is copied into a buffer of its own.
+    static bool Read(const QByteArray &data, const std::string &generation, Items *items);
+};
@@ -0,0 +1,88 @@
+/*
+    Copyright 2016 Ilya Zhuravlev
+
+    This file is part of Acquisition.
+
+    Acquisition is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Acquisition is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Acquisition.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "itemsrequestqueue.h"
+
+#include <algorithm>
+#include <limits>
+#include <tuple>
+
+bool ItemsRequestQueue::Entry::operator<(const Entry &other) const {
+    return std::tie(priority, not_before, order) < std::tie(other.priority, other.not_before, other.order);
+}
+
+void ItemsRequestQueue::Push(const ItemsRequest &request, Priority priority, qint64 not_before) {
+    Entry entry;
+    entry.priority = priority;
+    entry.not_before = not_before;
+    entry.order = order_++;
+    entry.request = request;
+    entries_.insert(entry);
+}
+
+bool ItemsRequestQueue::Pop(qint64 now, ItemsRequest *request, const Filter &filter) {
+    // Entries that have to wait sort after the ready ones of the same priority,
+    // but they may still come before ready entries of a lower one.
+    for (auto it = entries_.begin(); it != entries_.end(); ++it) {
+        if (it->not_before > now || (filter && !filter(it->request)))
+            continue;
+        *request = it->request;
+        entries_.erase(it);
+        return true;
+    }
+    return false;
+}
+
+int ItemsRequestQueue::RemoveIf(const Filter &filter) {
+    int removed = 0;
+    for (auto it = entries_.begin(); it != entries_.end();) {
+        if (filter(it->request)) {
+            it = entries_.erase(it);
+            ++removed;
+        } else {
+            ++it;
+        }
+    }
+    return removed;
+}
+
+qint64 ItemsRequestQueue::NextReady() const {
+    qint64 ready = std::numeric_limits<qint64>::max();
+    for (auto &entry : entries_)
+        ready = std::min(ready, entry.not_before);
+    return ready;
+}
+
+int ItemsRequestQueue::Waiting(qint64 now) const {
+    return static_cast<int>(std::count_if(entries_.begin(), entries_.end(), [now](const Entry &entry) {
+        return entry.not_before > now;
+    }));
+}
+
+qint64 ItemsRequestQueue::RetryDelay(int attempts, double jitter) {
+    qint64 delay = kRetryMaxDelay;
+    if (attempts < 16)
+        delay = std::min(delay, kRetryBaseDelay << std::max(0, attempts - 1));
+    return delay / 2 + static_cast<qint64>(delay / 2 * jitter);
+}
+
+void ItemsRequestQueue::clear() {
+    entries_.clear();
+    order_ = 0;
+}
@@ -0,0 +1,95 @@
+/*
+    Copyright 2016 Ilya Zhuravlev
+
+    This file is part of Acquisition.
+
+    Acquisition is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Acquisition is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Acquisition.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <functional>
+#include <set>
+#include <QNetworkRequest>
+#include <QtGlobal>
+
+#include "itemlocation.h"
+
+// Failed requests are retried after about 5, 10, 20... seconds, up to a minute.
+// A tab usually fails because the user has it open in the game, retrying it right
+// away only spends the rate limit on more errors.
+const int kMaxRequestAttempts = 6;
+const qint64 kRetryBaseDelay = 5000;
+const qint64 kRetryMaxDelay = 60000;
+
+struct ItemsRequest {
+    int id;
+    QNetworkRequest network_request;
+    ItemLocation location;
+    // how many times the request has failed so far
+    int attempts{};
+};
+
+/*
+ * ItemsRequestQueue decides in which order tabs and characters are fetched.
+ *
+ * With the rate limit in place a full refresh takes minutes, so the tabs the
+ * user cares about (the ones with buyouts, the ones explicitly selected for a
+ * refresh) should be done before the limiter starts making us wait.
+ * Requests are ordered by their priority, then by the time they may be sent
+ * at (failed requests are retried later), then in the order they were queued.
+ */
+class ItemsRequestQueue {
+public:
+    // Lower values are fetched first
+    enum Priority {
+        // Selected for a refresh by the user or holding items with buyouts
+        Urgent,
+        // Stash tabs that are checked for a refresh
+        Checked,
+        Character,
+        // Tabs that are not refreshed, fetched only to fill the cache
+        Refill
+    };
+    typedef std::function<bool(const ItemsRequest &)> Filter;
+
+    // `not_before` is the time in msecs since epoch before which the request must not be sent
+    void Push(const ItemsRequest &request, Priority priority, qint64 not_before = 0);
+    // Takes out the most important request that can be sent at `now` and is accepted by
+    // `filter` if one is given. Returns false if there is no such request.
+    bool Pop(qint64 now, ItemsRequest *request, const Filter &filter = Filter());
+    // Removes the requests accepted by `filter`, returns how many were removed
+    int RemoveIf(const Filter &filter);
+    // The earliest time at which one of the requests can be sent
+    qint64 NextReady() const;
+    // Number of requests that can't be sent yet at `now`
+    int Waiting(qint64 now) const;
+    // Msecs to wait before retrying a request that failed `attempts` times.
+    // `jitter` is in [0, 1) and spreads the retries over the upper half of the backoff.
+    static qint64 RetryDelay(int attempts, double jitter);
+    bool empty() const { return entries_.empty(); }
+    size_t size() const { return entries_.size(); }
+    void clear();
+private:
+    struct Entry {
+        Priority priority;
+        qint64 not_before;
+        int order;
+        ItemsRequest request;
+        bool operator<(const Entry &other) const;
+    };
+
+    std::set<Entry> entries_;
+    int order_{0};
+};
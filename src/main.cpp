@@ -48,6 +48,7 @@ int main(int argc, char *argv[])
 {
     qRegisterMetaType<CurrentStatusUpdate>("CurrentStatusUpdate");
     qRegisterMetaType<Items>("Items");
+    qRegisterMetaType<ItemsChangeSet>("ItemsChangeSet");
     qRegisterMetaType<std::vector<std::string>>("std::vector<std::string>");
     qRegisterMetaType<std::vector<ItemLocation>>("std::vector<ItemLocation>");
     qRegisterMetaType<QsLogging::Level>("QsLogging::Level");
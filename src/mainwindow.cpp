@@ -377,9 +377,12 @@ void MainWindow::OnStatusUpdate(const CurrentStatusUpdate &status) {
         break;
     case ProgramState::ItemsReceive:
     case ProgramState::ItemsPaused:
+    case ProgramState::ItemsDeferred:
         title = QString("Receiving stash data, %1/%2 [%3 from cache]").arg(status.progress).arg(status.total).arg(status.cached);
         if (status.state == ProgramState::ItemsPaused)
-            title += " (throttled, sleeping 60 seconds)";
+            title += QString(" (throttled, waiting %1 seconds)").arg(status.wait);
+        else if (status.state == ProgramState::ItemsDeferred)
+            title += QString(" (%1 failed, retrying in %2 seconds)").arg(status.deferred).arg(status.wait);
         need_progress = true;
         break;
     case ProgramState::ItemsCompleted:
@@ -404,7 +407,7 @@ void MainWindow::OnStatusUpdate(const CurrentStatusUpdate &status) {
     progress->setMinimum(0);
     progress->setMaximum(status.total);
     progress->setValue(status.progress);
-    progress->setPaused(status.state == ProgramState::ItemsPaused);
+    progress->setPaused(status.state == ProgramState::ItemsPaused || status.state == ProgramState::ItemsDeferred);
 #else
     (void)need_progress;//Fix compilation warning(unused var on non-windows)
 #endif
@@ -471,7 +474,7 @@ void MainWindow::ModelViewRefresh() {
 
     previous_search_ = current_search_;
 
-    current_search_->Activate(app_->items_manager().items());
+    current_search_->Activate(app_->items_manager().columns());
 
     ui->viewComboBox->setCurrentIndex(static_cast<int>(current_search_->GetViewMode()));
 
@@ -537,6 +540,7 @@ void MainWindow::AddSearchGroup(QLayout *layout, const std::string &name="") {
 
 void MainWindow::InitializeSearchForm() {
     auto name_search = std::make_unique<NameSearchFilter>(search_form_layout_);
+    auto mod_text_search = std::make_unique<ModTextFilter>(search_form_layout_);
     auto offense_layout = new FlowLayout;
     auto defense_layout = new FlowLayout;
     auto sockets_layout = new FlowLayout;
@@ -559,6 +563,7 @@ void MainWindow::InitializeSearchForm() {
     using move_only = std::unique_ptr<Filter>;
     move_only init[] = {
         std::move(name_search),
+        std::move(mod_text_search),
         // Offense
         // new DamageFilter(offense_layout, "Damage"),
         std::make_unique<SimplePropertyFilter>(offense_layout, "Critical Strike Chance", "Crit."),
@@ -680,11 +685,10 @@ void MainWindow::OnItemsRefreshed() {
     int tab = 0;
     for (auto search : searches_) {
         search->SetRefreshReason(RefreshReason::ItemsChanged);
-        // Don't update current search - it will be updated in OnSearchFormChange
-        if (search != current_search_) {
-            search->FilterItems(app_->items_manager().items());
+        search->FilterItems(app_->items_manager().columns(), app_->items_manager().changes());
+        // Current search caption will be updated in ModelViewRefresh
+        if (search != current_search_)
             tab_bar_->setTabText(tab, search->GetCaption());
-        }
         tab++;
     }
     ModelViewRefresh();
@@ -66,6 +66,8 @@ enum class ProgramState {
     CharactersReceived,
     ItemsReceive,
     ItemsPaused,
+    // waiting to retry requests that failed
+    ItemsDeferred,
     ItemsCompleted,
     ShopSubmitting,
     ShopCompleted
@@ -74,6 +76,10 @@ enum class ProgramState {
 struct CurrentStatusUpdate {
     ProgramState state;
     int progress{}, total{}, cached{};
+    // seconds until the next request is sent, for ItemsPaused and ItemsDeferred
+    int wait{};
+    // number of failed requests waiting to be retried, for ItemsDeferred
+    int deferred{};
 };
 
 class MainWindow : public QMainWindow {
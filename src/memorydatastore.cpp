@@ -40,6 +40,28 @@ std::vector<CurrencyUpdate> MemoryDataStore::GetAllCurrency() {
     return currency_updates_;
 }
 
+bool MemoryDataStore::SetItems(const std::string &location, const std::vector<ItemRecord> &items) {
+    if (items.empty())
+        items_.erase(location);
+    else
+        items_[location] = items;
+    return true;
+}
+
+std::vector<ItemRecord> MemoryDataStore::GetItems(const std::string &location) {
+    auto i = items_.find(location);
+    if (i == items_.end())
+        return std::vector<ItemRecord>();
+    return i->second;
+}
+
+std::vector<std::string> MemoryDataStore::GetItemLocations() {
+    std::vector<std::string> result;
+    for (auto &pair : items_)
+        result.push_back(pair.first);
+    return result;
+}
+
 void MemoryDataStore::SetBool(const std::string &key, bool value) {
     SetInt(key, static_cast<int>(value));
 }
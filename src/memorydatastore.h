@@ -31,6 +31,9 @@ public:
     std::string Get(const std::string &key, const std::string &default_value = "");
     void InsertCurrencyUpdate(const CurrencyUpdate &update);
     std::vector<CurrencyUpdate> GetAllCurrency();
+    bool SetItems(const std::string &location, const std::vector<ItemRecord> &items);
+    std::vector<ItemRecord> GetItems(const std::string &location);
+    std::vector<std::string> GetItemLocations();
     void SetBool(const std::string &key, bool value);
     bool GetBool(const std::string &key, bool default_value = false);
     void SetInt(const std::string &key, int value);
@@ -38,4 +41,5 @@ public:
 private:
     std::map<std::string, std::string> data_;
     std::vector<CurrencyUpdate> currency_updates_;
+    std::map<std::string, std::vector<ItemRecord>> items_;
 };
@@ -19,6 +19,7 @@
 
 #include "modlist.h"
 
+#include <cstdlib>
 #include <memory>
 #include <string>
 #include <unordered_map>
@@ -32,6 +33,7 @@
 
 // Actual list of mods is computed at runtime
 QStringList mod_string_list;
+ModNames mod_names;
 
 // These are just summed, and the mod named as the first element of a vector is generated with value equaling the sum.
 // Both implicit and explicit fields are considered.
@@ -114,47 +116,59 @@ const std::vector<std::vector<std::string>> simple_sum = {
 std::vector<std::unique_ptr<ModGenerator>> mod_generators;
 
 void InitModlist() {
-    for (auto &list : simple_sum) {
+    for (auto &list : simple_sum)
         mod_string_list.push_back(list[0].c_str());
 
-        mod_generators.push_back(std::make_unique<SumModGenerator>(list[0], list));
+    mod_generators.push_back(std::make_unique<SumModGenerator>(simple_sum, &mod_names));
+}
+
+SumModGenerator::SumModGenerator(const std::vector<std::vector<std::string>> &sums, ModNames *names) {
+    // Templates don't contain digits, so they are their own skeletons
+    for (auto &list : sums) {
+        for (auto &match : list)
+            templates_[match].push_back(ids_.size());
+        ids_.push_back(names->Add(list[0]));
     }
 }
 
-SumModGenerator::SumModGenerator(const std::string &name, const std::vector<std::string> &sum):
-    name_(name),
-    matches_(sum)
-{}
-
-bool SumModGenerator::Match(const char *mod, double *output) {
-    bool found = false;
-    *output = 0.0;
-    for (auto &match : matches_) {
-        double result = 0.0;
-        if (Util::MatchMod(match.c_str(), mod, &result)) {
-            *output += result;
-            found = true;
+void SumModGenerator::Skeleton(const char *mod, std::string *skeleton, double *value) {
+    double result = 0.0;
+    int cnt = 0;
+    skeleton->clear();
+    for (auto pmod = mod; *pmod;) {
+        if (*pmod >= '0' && *pmod <= '9') {
+            ++cnt;
+            auto prev = pmod;
+            while ((*pmod >= '0' && *pmod <= '9') || *pmod == '.')
+                ++pmod;
+            result += std::strtod(prev, NULL);
+            skeleton->push_back('#');
+        } else {
+            skeleton->push_back(*pmod);
+            ++pmod;
         }
     }
+    *value = result / cnt;
+}
 
-    return found;
+void SumModGenerator::Match(const char *mod, ModTable *output) const {
+    std::string skeleton;
+    Match(mod, &skeleton, output);
 }
 
-void SumModGenerator::Generate(const rapidjson::Value &json, ModTable *output) {
-    bool mod_present = false;
-    double sum = 0;
-    for (auto &type : { "implicitMods", "explicitMods" }) {
-        if (!json.HasMember(type))
-            continue;
-        for (auto &mod : json[type]) {
-            double result;
-            if (Match(mod.GetString(), &result)) {
-                sum += result;
-                mod_present = true;
-            }
-        }
-    }
+void SumModGenerator::Match(const char *mod, std::string *skeleton, ModTable *output) const {
+    double value;
+    Skeleton(mod, skeleton, &value);
+    auto it = templates_.find(*skeleton);
+    if (it == templates_.end())
+        return;
+    for (auto index : it->second)
+        output->Add(ids_[index], value);
+}
 
-    if (mod_present)
-        (*output)[name_] = sum;
+void SumModGenerator::Generate(const Item &item, ModTable *output) {
+    std::string skeleton;
+    for (auto &type : { "implicitMods", "explicitMods" })
+        for (auto &mod : item.text_mods().at(type))
+            Match(mod.c_str(), &skeleton, output);
 }
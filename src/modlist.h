@@ -24,10 +24,10 @@
 #include <unordered_map>
 #include <vector>
 #include <QStringList>
-#include "rapidjson/document.h"
+
+#include "modtable.h"
 
 class Item;
-typedef std::unordered_map<std::string, double> ModTable;
 
 // This generates regular expressions for mods and does other setup, should be called when the app starts, perhaps in main()
 // Maybe this is not needed and constexpr could do the trick, but VS doesn't support it right now.
@@ -35,19 +35,40 @@ void InitModlist();
 
 class ModGenerator {
 public:
-    virtual void Generate(const rapidjson::Value &json, ModTable *output) = 0;
+    virtual ~ModGenerator() {}
+    virtual void Generate(const Item &item, ModTable *output) = 0;
 };
 
+/*
+ * SumModGenerator creates the summed pseudo-mods from simple_sum.
+ *
+ * The templates of all sums are compiled into one table keyed by the template
+ * text, so instead of trying every template against every mod line, a mod line
+ * has its numbers replaced by '#' and is looked up once. The hit lists every sum
+ * the template contributes to, e.g. "+# to all Attributes" adds to Strength,
+ * Dexterity, Intelligence and all Attributes.
+ */
 class SumModGenerator : public ModGenerator {
 public:
-    SumModGenerator(const std::string &name, const std::vector<std::string> &sum);
-    virtual void Generate(const rapidjson::Value &json, ModTable *output);
+    // The first template of each sum is also the name of the generated mod,
+    // which is registered in names.
+    SumModGenerator(const std::vector<std::vector<std::string>> &sums, ModNames *names);
+    virtual void Generate(const Item &item, ModTable *output);
+    // Adds whatever a single mod line contributes to the sums in output
+    void Match(const char *mod, ModTable *output) const;
 private:
-    bool Match(const char *mod, double *output);
+    // skeleton is scratch space, reused between the mods of an item
+    void Match(const char *mod, std::string *skeleton, ModTable *output) const;
+    // Replaces every number in mod with '#', value is the average of the numbers
+    // the same way Util::MatchMod computes it.
+    static void Skeleton(const char *mod, std::string *skeleton, double *value);
 
-    std::string name_;
-    std::vector<std::string> matches_;
+    // Mod ids of the sums
+    std::vector<int> ids_;
+    // template -> indices in ids_ of the sums it's part of
+    std::unordered_map<std::string, std::vector<size_t>> templates_;
 };
 
 extern QStringList mod_string_list;
+extern ModNames mod_names;
 extern std::vector<std::unique_ptr<ModGenerator>> mod_generators;
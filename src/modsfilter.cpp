@@ -19,6 +19,10 @@
 
 #include "modsfilter.h"
 
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <limits>
 #include <QComboBox>
 #include <QLineEdit>
 #include <QObject>
@@ -105,8 +109,10 @@ ModsFilter::ModsFilter(QLayout *parent):
 void ModsFilter::FromForm(FilterData *data) {
     auto &mod_data = data->mod_data;
     mod_data.clear();
-    for (auto &mod : mods_)
+    for (auto &mod : mods_) {
         mod_data.push_back(mod.data());
+        mod_data.back().mod_id = mod_names.Find(mod.data().mod);
+    }
 }
 
 void ModsFilter::ToForm(FilterData *data) {
@@ -121,14 +127,22 @@ void ModsFilter::ResetForm() {
     Refill();
 }
 
+// Returns ItemColumns::Missing() if the item doesn't have the mod. Mods without
+// a number (e.g. "Causes Bleeding on Hit") are generated as NaN, those count as 0.
+static double ModValue(const Item &item, int mod_id) {
+    const double *value = item.mod_table().Find(mod_id);
+    if (!value)
+        return ItemColumns::Missing();
+    return std::isnan(*value) ? 0 : *value;
+}
+
 bool ModsFilter::Matches(const std::shared_ptr<Item> &item, FilterData *data) {
     for (auto &mod : data->mod_data) {
         if (mod.mod.empty())
             continue;
-        const ModTable &mod_table = item->mod_table();
-        if (!mod_table.count(mod.mod))
+        double value = ModValue(*item, mod.mod_id);
+        if (std::isnan(value))
             return false;
-        double value = mod_table.at(mod.mod);
         if (mod.min_filled && value < mod.min)
             return false;
         if (mod.max_filled && value > mod.max)
@@ -137,6 +151,60 @@ bool ModsFilter::Matches(const std::shared_ptr<Item> &item, FilterData *data) {
     return true;
 }
 
+bool ModsFilter::Select(const ItemColumns &columns, FilterData *data, ItemColumns::Selection *selection) {
+    // Only a few items have any given mod, so every mod is a binary search over
+    // the items that have it and the resulting id lists are intersected.
+    ItemColumns::Ids ids, range, both;
+    bool first = true;
+    for (auto &mod : data->mod_data) {
+        if (mod.mod.empty())
+            continue;
+        int mod_id = mod.mod_id;
+        auto &column = columns.GetSorted(this, mod_id, [mod_id](const std::shared_ptr<Item> &item) {
+            return ModValue(*item, mod_id);
+        });
+        double min = mod.min_filled ? mod.min : -std::numeric_limits<double>::infinity();
+        double max = mod.max_filled ? mod.max : std::numeric_limits<double>::infinity();
+        if (first) {
+            ItemColumns::RangeIds(column, min, max, &ids);
+            first = false;
+            continue;
+        }
+        ItemColumns::RangeIds(column, min, max, &range);
+        both.clear();
+        std::set_intersection(ids.begin(), ids.end(), range.begin(), range.end(), std::back_inserter(both));
+        ids.swap(both);
+    }
+    if (!first)
+        ItemColumns::SelectIds(ids, selection);
+    return true;
+}
+
+bool ModsFilter::Narrows(const FilterData &before, const FilterData &after) {
+    // Every mod required before must still be required, with bounds at least as tight
+    for (auto &before_mod : before.mod_data) {
+        if (before_mod.mod.empty())
+            continue;
+        bool found = false;
+        for (auto &after_mod : after.mod_data) {
+            if (after_mod.mod == before_mod.mod && BoundsNarrow(before_mod, after_mod)) {
+                found = true;
+                break;
+            }
+        }
+        if (!found)
+            return false;
+    }
+    return true;
+}
+
+bool ModsFilter::IsActive(const FilterData &data) {
+    for (auto &mod : data.mod_data)
+        if (!mod.mod.empty())
+            return true;
+    return false;
+}
+
 void ModsFilter::Initialize(QLayout *parent) {
     layout_ = std::make_unique<QGridLayout>();
     add_button_ = std::make_unique<QPushButton>("Add mod");
@@ -89,6 +89,9 @@ public:
     void ToForm(FilterData *data);
     void ResetForm();
     bool Matches(const std::shared_ptr<Item> &item, FilterData *data);
+    bool Select(const ItemColumns &columns, FilterData *data, ItemColumns::Selection *selection);
+    bool Narrows(const FilterData &before, const FilterData &after);
+    bool IsActive(const FilterData &data);
 private:
     void Clear();
     void ClearSignalMapper();
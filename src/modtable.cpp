@@ -0,0 +1,76 @@
+/*
+    Copyright 2016 Ilya Zhuravlev
+
+    This file is part of Acquisition.
+
+    Acquisition is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Acquisition is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Acquisition.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "modtable.h"
+
+#include <algorithm>
+
+int ModNames::Add(const std::string &name) {
+    auto it = ids_.find(name);
+    if (it != ids_.end())
+        return it->second;
+    int id = names_.size();
+    names_.push_back(name);
+    ids_[name] = id;
+    return id;
+}
+
+int ModNames::Find(const std::string &name) const {
+    auto it = ids_.find(name);
+    return it == ids_.end() ? -1 : it->second;
+}
+
+uint64_t ModNames::Fingerprint() const {
+    // FNV-1a, it has to be the same from one run to the next
+    uint64_t hash = 14695981039346656037ULL;
+    for (auto &name : names_) {
+        for (char c : name) {
+            hash ^= static_cast<unsigned char>(c);
+            hash *= 1099511628211ULL;
+        }
+        // so that moving a character from a name to the next one changes the hash
+        hash ^= '\n';
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static bool EntryBefore(const ModTable::Entry &entry, int id) {
+    return entry.id < id;
+}
+
+void ModTable::Add(int id, double value) {
+    // Tables read from a snapshot come in order
+    if (entries_.empty() || entries_.back().id < id) {
+        entries_.push_back(Entry{ id, value });
+        return;
+    }
+    auto it = std::lower_bound(entries_.begin(), entries_.end(), id, EntryBefore);
+    if (it != entries_.end() && it->id == id)
+        it->value += value;
+    else
+        entries_.insert(it, Entry{ id, value });
+}
+
+const double *ModTable::Find(int id) const {
+    auto it = std::lower_bound(entries_.begin(), entries_.end(), id, EntryBefore);
+    if (it == entries_.end() || it->id != id)
+        return nullptr;
+    return &it->value;
+}
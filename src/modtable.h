@@ -0,0 +1,74 @@
+/*
+    Copyright 2016 Ilya Zhuravlev
+
+    This file is part of Acquisition.
+
+    Acquisition is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Acquisition is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Acquisition.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/*
+ * ModNames gives ids to the names of generated mods (see modlist.h).
+ *
+ * The ids are assigned once at startup, items store their mods by id and
+ * filters look the name up once per search instead of once per item.
+ */
+class ModNames {
+public:
+    // Returns the id of the name, a new one if the name wasn't seen before
+    int Add(const std::string &name);
+    // Returns -1 if there's no such mod
+    int Find(const std::string &name) const;
+    const std::string &Name(int id) const { return names_[id]; }
+    size_t size() const { return names_.size(); }
+    // Hash of the names in id order, changes whenever an id would mean another mod
+    uint64_t Fingerprint() const;
+private:
+    std::vector<std::string> names_;
+    std::unordered_map<std::string, int> ids_;
+};
+
+/*
+ * ModTable holds the values of an item's generated mods as (id, value) pairs
+ * sorted by id. Items only have a handful of generated mods, so a sorted array
+ * is both smaller and faster to search than a hash map of names.
+ */
+class ModTable {
+public:
+    struct Entry {
+        int id;
+        double value;
+        bool operator==(const Entry &other) const { return id == other.id && value == other.value; }
+    };
+    typedef std::vector<Entry>::const_iterator const_iterator;
+
+    // Adds value to the mod, creating it if it's not in the table yet
+    void Add(int id, double value);
+    // Returns nullptr if the item doesn't have the mod
+    const double *Find(int id) const;
+    const_iterator begin() const { return entries_.begin(); }
+    const_iterator end() const { return entries_.end(); }
+    size_t size() const { return entries_.size(); }
+    bool empty() const { return entries_.empty(); }
+    bool operator==(const ModTable &other) const { return entries_ == other.entries_; }
+    bool operator!=(const ModTable &other) const { return !(*this == other); }
+private:
+    std::vector<Entry> entries_;
+};
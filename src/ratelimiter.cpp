@@ -0,0 +1,239 @@
+/*
+    Copyright 2016 Ilya Zhuravlev
+
+    This file is part of Acquisition.
+
+    Acquisition is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Acquisition is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Acquisition.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "ratelimiter.h"
+
+#include <QDateTime>
+#include <QNetworkReply>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include "QsLog.h"
+#include "rapidjson/document.h"
+
+#include "datastore.h"
+#include "util.h"
+
+// Bucket for the assumed limits, dropped as soon as the server reports the real ones
+const char *kDefaultBucket = "default";
+
+RateLimiter::RateLimiter(DataStore &data) :
+    data_(data)
+{
+    Load();
+}
+
+void RateLimiter::Reset() {
+    policy_.clear();
+    buckets_.clear();
+    blocked_until_ = 0;
+    AddBucket(kDefaultBucket, kThrottleRequests, kThrottleSleep, 0);
+}
+
+void RateLimiter::AddBucket(const std::string &key, int max_hits, int period, qint64 now) {
+    Bucket bucket;
+    bucket.max_hits = max_hits;
+    bucket.period = std::max(1, period);
+    bucket.tokens = 0;
+    bucket.updated = now;
+    bucket.tokens = BurstSize(bucket);
+    buckets_[key] = bucket;
+}
+
+int RateLimiter::BurstSize(const Bucket &bucket) {
+    // Keep one request of headroom for the network latency and the main page/character list requests
+    return std::min(kRateLimitBurst, std::max(1, bucket.max_hits - 1));
+}
+
+double RateLimiter::RefillRate(const Bucket &bucket) {
+    // A full bucket plus whatever is refilled during a period must not exceed the limit,
+    // otherwise a burst at the start of a window followed by steady requests would trip it.
+    int refilled = std::max(1, bucket.max_hits - 1 - BurstSize(bucket));
+    return refilled / (bucket.period * 1000.0);
+}
+
+double RateLimiter::TokensAt(const Bucket &bucket, qint64 now) {
+    qint64 elapsed = std::max<qint64>(0, now - bucket.updated);
+    return std::min<double>(BurstSize(bucket), bucket.tokens + elapsed * RefillRate(bucket));
+}
+
+qint64 RateLimiter::Delay(qint64 now) const {
+    qint64 delay = std::max<qint64>(0, blocked_until_ - now);
+    for (auto &pair : buckets_) {
+        const Bucket &bucket = pair.second;
+        double tokens = TokensAt(bucket, now);
+        if (tokens < 1)
+            delay = std::max(delay, static_cast<qint64>(std::ceil((1 - tokens) / RefillRate(bucket))));
+    }
+    return delay;
+}
+
+void RateLimiter::OnRequestSent(qint64 now) {
+    // Tokens are allowed to go negative: requests that bypass Delay() (like the
+    // character list) still have to be paid for by the ones that follow.
+    for (auto &pair : buckets_) {
+        Bucket &bucket = pair.second;
+        bucket.tokens = TokensAt(bucket, now) - 1;
+        bucket.updated = now;
+    }
+}
+
+void RateLimiter::OnReply(QNetworkReply *reply) {
+    // The headers of a cached reply describe the state at the time it was stored
+    if (reply->attribute(QNetworkRequest::SourceIsFromCacheAttribute).toBool())
+        return;
+    Headers headers;
+    for (auto &header : reply->rawHeaderPairs())
+        headers[QString(header.first).toLower().toStdString()] = header.second.constData();
+    Update(headers, QDateTime::currentMSecsSinceEpoch());
+}
+
+void RateLimiter::Update(const Headers &headers, qint64 now) {
+    auto header = [&headers](const std::string &name) {
+        auto it = headers.find(name);
+        return it == headers.end() ? std::string() : it->second;
+    };
+
+    // Token counts alone aren't worth a write, they're saved with the next
+    // change of limits or at the end of a refresh.
+    bool changed = false;
+    qint64 blocked_until = blocked_until_;
+    std::string policy = header("x-rate-limit-policy");
+    if (!policy.empty()) {
+        if (policy != policy_) {
+            QLOG_DEBUG() << "Rate limit policy changed to" << policy.c_str();
+            policy_ = policy;
+            changed = true;
+        }
+        if (buckets_.erase(kDefaultBucket))
+            changed = true;
+        for (auto rule : Util::StringSplit(header("x-rate-limit-rules"), ',')) {
+            std::transform(rule.begin(), rule.end(), rule.begin(), ::tolower);
+            auto limits = Util::StringSplit(header("x-rate-limit-" + rule), ',');
+            auto states = Util::StringSplit(header("x-rate-limit-" + rule + "-state"), ',');
+            for (size_t i = 0; i < limits.size(); ++i) {
+                auto limit = Util::StringSplit(limits[i], ':');
+                if (limit.size() < 2)
+                    continue;
+                int max_hits = std::atoi(limit[0].c_str());
+                int period = std::atoi(limit[1].c_str());
+                if (max_hits <= 0 || period <= 0)
+                    continue;
+                std::string key = policy + ":" + rule + ":" + limit[1];
+                auto it = buckets_.find(key);
+                if (it == buckets_.end() || it->second.max_hits != max_hits || it->second.period != period) {
+                    AddBucket(key, max_hits, period, now);
+                    changed = true;
+                }
+
+                if (i >= states.size())
+                    continue;
+                auto state = Util::StringSplit(states[i], ':');
+                if (state.size() < 3)
+                    continue;
+                // The server may know about requests we didn't make (e.g. the website
+                // open in a browser), its count wins if it's higher than ours.
+                Bucket &bucket = buckets_[key];
+                int hits = std::atoi(state[0].c_str());
+                bucket.tokens = std::min(TokensAt(bucket, now), static_cast<double>(max_hits - 1 - hits));
+                bucket.updated = now;
+                int restricted = std::atoi(state[2].c_str());
+                if (restricted > 0) {
+                    QLOG_WARN() << "Rate limit exceeded, requests are restricted for" << restricted << "seconds";
+                    blocked_until_ = std::max(blocked_until_, now + restricted * 1000LL);
+                }
+            }
+        }
+    }
+
+    std::string retry_after = header("retry-after");
+    if (!retry_after.empty())
+        blocked_until_ = std::max(blocked_until_, now + std::atoi(retry_after.c_str()) * 1000LL);
+
+    if (changed || blocked_until_ != blocked_until)
+        Save();
+}
+
+void RateLimiter::Save() {
+    rapidjson::Document doc;
+    doc.SetObject();
+    auto &alloc = doc.GetAllocator();
+
+    rapidjson::Value policy;
+    policy.SetString(policy_.c_str(), policy_.size(), alloc);
+    doc.AddMember("policy", policy, alloc);
+    doc.AddMember("blocked_until", static_cast<int64_t>(blocked_until_), alloc);
+
+    rapidjson::Value buckets(rapidjson::kObjectType);
+    for (auto &pair : buckets_) {
+        const Bucket &bucket = pair.second;
+        rapidjson::Value value(rapidjson::kObjectType);
+        value.AddMember("max_hits", bucket.max_hits, alloc);
+        value.AddMember("period", bucket.period, alloc);
+        value.AddMember("tokens", bucket.tokens, alloc);
+        value.AddMember("updated", static_cast<int64_t>(bucket.updated), alloc);
+        rapidjson::Value key(pair.first.c_str(), alloc);
+        buckets.AddMember(key, value, alloc);
+    }
+    doc.AddMember("buckets", buckets, alloc);
+
+    data_.Set("rate_limit", Util::RapidjsonSerialize(doc));
+}
+
+void RateLimiter::Load() {
+    Reset();
+
+    std::string data = data_.Get("rate_limit");
+    // Nothing saved yet, stick to the defaults
+    if (data.empty())
+        return;
+
+    rapidjson::Document doc;
+    if (doc.Parse(data.c_str()).HasParseError() || !doc.IsObject()
+            || !doc.HasMember("buckets") || !doc["buckets"].IsObject()) {
+        QLOG_WARN() << "Malformed rate limit state:" << data.c_str();
+        return;
+    }
+
+    if (doc.HasMember("policy") && doc["policy"].IsString())
+        policy_ = doc["policy"].GetString();
+    if (doc.HasMember("blocked_until") && doc["blocked_until"].IsInt64())
+        blocked_until_ = doc["blocked_until"].GetInt64();
+
+    // Buckets of the wrong type are skipped, the defaults stay if none is left
+    std::map<std::string, Bucket> loaded;
+    auto &buckets = doc["buckets"];
+    for (auto itr = buckets.MemberBegin(); itr != buckets.MemberEnd(); ++itr) {
+        auto &value = itr->value;
+        if (!value.IsObject()
+                || !value.HasMember("max_hits") || !value["max_hits"].IsInt()
+                || !value.HasMember("period") || !value["period"].IsInt()
+                || !value.HasMember("tokens") || !value["tokens"].IsNumber()
+                || !value.HasMember("updated") || !value["updated"].IsInt64())
+            continue;
+        Bucket bucket;
+        bucket.max_hits = value["max_hits"].GetInt();
+        bucket.period = std::max(1, value["period"].GetInt());
+        bucket.tokens = value["tokens"].GetDouble();
+        bucket.updated = value["updated"].GetInt64();
+        loaded[itr->name.GetString()] = bucket;
+    }
+    if (!loaded.empty())
+        buckets_.swap(loaded);
+}
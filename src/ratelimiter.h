@@ -0,0 +1,95 @@
+/*
+    Copyright 2016 Ilya Zhuravlev
+
+    This file is part of Acquisition.
+
+    Acquisition is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Acquisition is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Acquisition.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <map>
+#include <string>
+#include <QtGlobal>
+
+class DataStore;
+class QNetworkReply;
+
+// Limits assumed until the server tells us the real ones: 45 requests per 60 seconds.
+// These values are approximated (GGG throttles requests) based on some quick testing.
+const int kThrottleRequests = 45;
+const int kThrottleSleep = 60;
+// How many requests may be sent back to back before pacing kicks in.
+const int kRateLimitBurst = 3;
+
+/*
+ * RateLimiter paces requests to the Path of Exile API.
+ *
+ * The API describes its limits in reply headers:
+ *   X-Rate-Limit-Policy: backend-item-request-limit
+ *   X-Rate-Limit-Rules: Ip
+ *   X-Rate-Limit-Ip: 45:60:60,240:240:900        (hits:period:restriction, seconds)
+ *   X-Rate-Limit-Ip-State: 1:60:0,1:240:0        (hits:period:active restriction)
+ *   Retry-After: 60                              (only when we're already restricted)
+ *
+ * Every policy:rule:period triple gets a token bucket which refills continuously,
+ * slowly enough that no window of `period` seconds can contain more than `hits`
+ * requests. Different endpoints may report different policies; a request has to
+ * wait for all of them, which is conservative but never trips a limit.
+ * So instead of firing a burst and sleeping for a minute we send every request
+ * as soon as the server would accept it. The state reported by the server is
+ * used to catch up with requests we didn't account for (e.g. the website open in
+ * a browser), and the whole thing is saved to the DataStore so a restart doesn't
+ * forget how much of the budget was already spent. Saving after every request
+ * would cost a write per API call, so that only happens when the limits or
+ * restrictions change and after each refresh.
+ */
+class RateLimiter {
+public:
+    // Header names are case insensitive, keys here are expected to be lowercase.
+    typedef std::map<std::string, std::string> Headers;
+
+    explicit RateLimiter(DataStore &data);
+    // Milliseconds to wait before the next request can be sent, 0 if it can be sent right away.
+    qint64 Delay(qint64 now) const;
+    // Must be called for every request that is going to reach the server.
+    // Spent tokens are only kept in memory until the next Save().
+    void OnRequestSent(qint64 now);
+    // Reads the current limits and state from the reply, cached replies are ignored.
+    // Saves the state when the limits or a restriction change.
+    void OnReply(QNetworkReply *reply);
+    void Update(const Headers &headers, qint64 now);
+    void Load();
+    // Called at the end of a refresh and on shutdown
+    void Save();
+    // The policy reported by the last reply
+    const std::string &policy() const { return policy_; }
+private:
+    struct Bucket {
+        int max_hits;
+        int period;
+        double tokens;
+        qint64 updated;
+    };
+    void Reset();
+    void AddBucket(const std::string &key, int max_hits, int period, qint64 now);
+    static int BurstSize(const Bucket &bucket);
+    static double RefillRate(const Bucket &bucket);
+    static double TokensAt(const Bucket &bucket, qint64 now);
+
+    DataStore &data_;
+    std::string policy_;
+    std::map<std::string, Bucket> buckets_;
+    qint64 blocked_until_{0};
+};
@@ -0,0 +1,140 @@
+/*
+    Copyright 2016 Ilya Zhuravlev
+
+    This file is part of Acquisition.
+
+    Acquisition is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Acquisition is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Acquisition.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "refreshcheckpoint.h"
+
+#include "QsLog.h"
+#include "rapidjson/document.h"
+
+#include "datastore.h"
+#include "util.h"
+
+const char *kCheckpointKey = "refresh_checkpoint";
+// Items we had before an older checkpoint are too outdated to be worth resuming from
+const qint64 kCheckpointMaxAge = 60 * 60 * 1000;
+// Locations done between two writes of the checkpoint
+const int kCheckpointBatch = 16;
+
+RefreshCheckpoint::RefreshCheckpoint(DataStore &data) :
+    data_(data)
+{}
+
+bool RefreshCheckpoint::Start(TabCache::Policy policy, qint64 now) {
+    Load();
+    bool resume = !locations_.empty() && CanResume(policy) && policy_ == policy
+        && now - started_ <= kCheckpointMaxAge;
+    if (!resume) {
+        if (!locations_.empty())
+            QLOG_DEBUG() << "Not resuming the refresh checkpoint";
+        Clear();
+        policy_ = policy;
+        started_ = now;
+    }
+    return resume;
+}
+
+void RefreshCheckpoint::Add(const ItemLocation &location, quint64 hash) {
+    locations_[location] = hash;
+    OnChanged();
+}
+
+void RefreshCheckpoint::Remove(const ItemLocation &location) {
+    if (locations_.erase(location))
+        OnChanged();
+}
+
+void RefreshCheckpoint::OnChanged() {
+    if (++unsaved_ >= kCheckpointBatch)
+        Save();
+}
+
+void RefreshCheckpoint::Save() {
+    unsaved_ = 0;
+    if (!CanResume(policy_) || locations_.empty()) {
+        data_.Set(kCheckpointKey, "");
+        return;
+    }
+
+    rapidjson::Document doc;
+    doc.SetObject();
+    auto &alloc = doc.GetAllocator();
+    doc.AddMember("started", static_cast<int64_t>(started_), alloc);
+    doc.AddMember("policy", static_cast<int>(policy_), alloc);
+
+    rapidjson::Value locations(rapidjson::kArrayType);
+    for (auto &pair : locations_) {
+        const ItemLocation &location = pair.first;
+        bool stash = location.get_type() == ItemLocationType::STASH;
+        rapidjson::Value value(rapidjson::kObjectType);
+        value.AddMember("stash", stash, alloc);
+        value.AddMember("tab", location.get_tab_id(), alloc);
+        Util::RapidjsonAddConstString(&value, "name", stash ? location.get_tab_label() : location.get_character(), alloc);
+        value.AddMember("hash", static_cast<uint64_t>(pair.second), alloc);
+        locations.PushBack(value, alloc);
+    }
+    doc.AddMember("locations", locations, alloc);
+
+    data_.Set(kCheckpointKey, Util::RapidjsonSerialize(doc));
+}
+
+void RefreshCheckpoint::Clear() {
+    bool saved = !locations_.empty() || unsaved_ > 0;
+    locations_.clear();
+    unsaved_ = 0;
+    started_ = 0;
+    if (saved)
+        data_.Set(kCheckpointKey, "");
+}
+
+void RefreshCheckpoint::Load() {
+    locations_.clear();
+    unsaved_ = 0;
+    started_ = 0;
+
+    std::string data = data_.Get(kCheckpointKey);
+    if (data.empty())
+        return;
+
+    rapidjson::Document doc;
+    if (doc.Parse(data.c_str()).HasParseError() || !doc.IsObject() || !doc.HasMember("started")
+            || !doc["started"].IsInt64() || !doc.HasMember("policy") || !doc["policy"].IsInt()
+            || !doc.HasMember("locations") || !doc["locations"].IsArray()) {
+        QLOG_WARN() << "Malformed refresh checkpoint:" << data.c_str();
+        data_.Set(kCheckpointKey, "");
+        return;
+    }
+    started_ = doc["started"].GetInt64();
+    policy_ = static_cast<TabCache::Policy>(doc["policy"].GetInt());
+
+    for (auto &value : doc["locations"]) {
+        if (!value.IsObject() || !value.HasMember("stash") || !value["stash"].IsBool()
+                || !value.HasMember("tab") || !value["tab"].IsInt() || !value.HasMember("name") || !value["name"].IsString()
+                || !value.HasMember("hash") || !value["hash"].IsUint64())
+            continue;
+        ItemLocation location;
+        std::string name = value["name"].GetString();
+        if (value["stash"].GetBool()) {
+            location = ItemLocation(value["tab"].GetInt(), name, ItemLocationType::STASH);
+        } else {
+            location.set_type(ItemLocationType::CHARACTER);
+            location.set_character(name);
+        }
+        locations_[location] = value["hash"].GetUint64();
+    }
+}
@@ -0,0 +1,67 @@
+/*
+    Copyright 2016 Ilya Zhuravlev
+
+    This file is part of Acquisition.
+
+    Acquisition is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Acquisition is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Acquisition.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <map>
+#include <QtGlobal>
+
+#include "itemlocation.h"
+#include "tabcache.h"
+
+class DataStore;
+
+/*
+ * RefreshCheckpoint remembers the locations a refresh found unchanged, so that
+ * a refresh interrupted by a restart or a network failure doesn't spend the rate
+ * limit on them again.
+ *
+ * Only locations and reply hashes are saved: the items of such a location are
+ * the ones we had before the refresh, locations that did change are simply
+ * fetched again. Writes are batched, a crash costs at most the last few locations.
+ *
+ * Only automatic refreshes resume a checkpoint, and only one left by a refresh of
+ * the same kind. A manual refresh has to fetch what the user asked for.
+ */
+class RefreshCheckpoint {
+public:
+    explicit RefreshCheckpoint(DataStore &data);
+    // Starts a refresh with the policy. Returns true if it resumes the saved checkpoint,
+    // locations() are already done then. Otherwise the saved checkpoint is dropped.
+    bool Start(TabCache::Policy policy, qint64 now);
+    // The reply for the location had this hash and the location's items didn't change
+    void Add(const ItemLocation &location, quint64 hash);
+    void Remove(const ItemLocation &location);
+    // Writes whatever wasn't written yet
+    void Save();
+    // Forgets the checkpoint once the refresh is over
+    void Clear();
+    const std::map<ItemLocation, quint64> &locations() const { return locations_; }
+    static bool CanResume(TabCache::Policy policy) { return policy == TabCache::DefaultCache; }
+private:
+    void Load();
+    void OnChanged();
+
+    DataStore &data_;
+    TabCache::Policy policy_{TabCache::DefaultCache};
+    qint64 started_{0};
+    std::map<ItemLocation, quint64> locations_;
+    // changes since the last write
+    int unsaved_{0};
+};
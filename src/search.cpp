@@ -19,9 +19,13 @@
 
 #include "search.h"
 
+#include <algorithm>
 #include <iostream>
+#include <map>
 #include <memory>
+#include <QElapsedTimer>
 #include <QTreeView>
+#include <QtConcurrent>
 
 #include "buyoutmanager.h"
 #include "bucket.h"
@@ -31,6 +35,77 @@
 #include "QsLog.h"
 #include <QMessageBox>
 
+namespace {
+
+// Items per chunk when filtering and bucketing is spread over the thread pool
+const size_t kChunkSize = 4096;
+// Items every filter is tried on to decide the order in which filters are checked
+const size_t kSampleSize = 64;
+
+struct Chunk {
+    size_t begin, end;
+};
+
+struct FilterChunk : Chunk {
+    Items items;
+};
+
+struct BucketChunk : Chunk {
+    std::map<ItemLocation, Items> tabs;
+};
+
+template <typename T>
+std::vector<T> MakeChunks(size_t size) {
+    std::vector<T> chunks(std::max<size_t>(1, (size + kChunkSize - 1) / kChunkSize));
+    for (size_t i = 0; i < chunks.size(); ++i) {
+        chunks[i].begin = i * kChunkSize;
+        chunks[i].end = std::min(size, (i + 1) * kChunkSize);
+    }
+    return chunks;
+}
+
+// Calls func on every element, on the global thread pool if there's more than one
+template <typename T, typename Func>
+void RunParallel(std::vector<T> &elements, Func func) {
+    if (elements.size() == 1)
+        func(elements.front());
+    else if (!elements.empty())
+        QtConcurrent::blockingMap(elements, func);
+}
+
+bool MatchesAll(const std::shared_ptr<Item> &item, const std::vector<FilterData*> &filters) {
+    for (auto filter : filters)
+        if (!filter->Matches(item))
+            return false;
+    return true;
+}
+
+// Up to kSampleSize items spread evenly over the selected ones
+Items SampleItems(const Items &items, const ItemColumns::Selection *selection) {
+    size_t count = items.size();
+    if (selection)
+        count = std::count_if(selection->begin(), selection->end(), [](unsigned char selected) { return selected != 0; });
+    size_t step = std::max<size_t>(1, count / kSampleSize);
+    Items sample;
+    size_t seen = 0;
+    for (size_t i = 0; i < items.size() && sample.size() < kSampleSize; ++i) {
+        if (selection && !(*selection)[i])
+            continue;
+        if (seen++ % step == 0)
+            sample.push_back(items[i]);
+    }
+    return sample;
+}
+
+Items JoinChunks(const std::vector<FilterChunk> &chunks) {
+    Items result;
+    for (auto &chunk : chunks)
+        result.insert(result.end(), chunk.items.begin(), chunk.items.end());
+    return result;
+}
+
+} // namespace
+
 Search::Search(BuyoutManager &bo_manager, const std::string &caption,
                const std::vector<std::unique_ptr<Filter>> &filters, QTreeView *view) :
     caption_(caption),
@@ -104,38 +179,182 @@ const std::unique_ptr<Bucket> &Search::bucket(int row) const {
     return active_buckets[row];
 }
 
-void Search::FilterItems(const Items &items) {
+void Search::FilterItems(const ItemColumns &columns) {
     // If we're just changing tabs we don't need to update anything
     if (refresh_reason_ == RefreshReason::TabChanged)
         return;
 
-    QLOG_DEBUG() << "FilterItems: reason(" << refresh_reason_ << ")";
-    items_.clear();
-    for (const auto &item : items) {
-        bool matches = true;
-        for (auto &filter : filters_)
-            if (!filter->Matches(item)) {
-                matches = false;
-                break;
-            }
-        if (matches)
-            items_.push_back(item);
+    const Items &items = columns.items();
+    std::vector<FilterData*> changed;
+    if (CanNarrow(columns, &changed)) {
+        // Only the items found last time can still match
+        QLOG_DEBUG() << "FilterItems: reason(" << refresh_reason_ << "), narrowing" << items_.size() << "items";
+        changed.erase(std::remove_if(changed.begin(), changed.end(), [](FilterData *filter) {
+            return !filter->IsActive();
+        }), changed.end());
+        OrderFilters(items_, nullptr, &changed);
+        auto chunks = MakeChunks<FilterChunk>(items_.size());
+        RunParallel(chunks, [&](FilterChunk &chunk) {
+            for (size_t i = chunk.begin; i < chunk.end; ++i)
+                if (MatchesAll(items_[i], changed))
+                    chunk.items.push_back(items_[i]);
+        });
+        items_ = JoinChunks(chunks);
+    } else {
+        QLOG_DEBUG() << "FilterItems: reason(" << refresh_reason_ << ")";
+        // Filters that support it narrow down the selection over columns first,
+        // the rest only look at the items that are left.
+        ItemColumns::Selection selection = columns.SelectAll();
+        std::vector<FilterData*> remaining;
+        for (auto filter : ActiveFilters()) {
+            if (!filter->Select(columns, &selection))
+                remaining.push_back(filter);
+        }
+        OrderFilters(items, &selection, &remaining);
+
+        // Chunks are filtered in parallel and joined in their original order
+        auto chunks = MakeChunks<FilterChunk>(items.size());
+        RunParallel(chunks, [&](FilterChunk &chunk) {
+            for (size_t i = chunk.begin; i < chunk.end; ++i)
+                if (selection[i] && MatchesAll(items[i], remaining))
+                    chunk.items.push_back(items[i]);
+        });
+        items_ = JoinChunks(chunks);
     }
 
+    filtered_with_.clear();
+    for (auto &filter : filters_)
+        filtered_with_.push_back(*filter);
+    filtered_generation_ = columns.generation();
+    filtered_buyouts_ = bo_manager_.generation();
+
     UpdateItemCounts(items);
+    UpdateBuckets();
+}
+
+bool Search::CanNarrow(const ItemColumns &columns, std::vector<FilterData*> *changed) const {
+    if (filtered_generation_ != columns.generation() || filtered_with_.size() != filters_.size())
+        return false;
+    for (size_t i = 0; i < filters_.size(); ++i) {
+        const FilterData &before = filtered_with_[i];
+        FilterData &after = *filters_[i];
+        if (!after.Narrows(before))
+            return false;
+        if (after != before)
+            changed->push_back(&after);
+    }
+    return true;
+}
 
+void Search::FilterItems(const ItemColumns &columns, const ItemsChangeSet &changes) {
+    auto filters = ActiveFilters();
+    // Earlier matches of such a filter are stale in the locations that didn't change as well
+    bool uses_buyouts = std::any_of(filters.begin(), filters.end(), [](FilterData *filter) {
+        return filter->UsesBuyouts();
+    });
+    if (uses_buyouts && filtered_buyouts_ != bo_manager_.generation()) {
+        FilterItems(columns);
+        return;
+    }
+
+    QLOG_DEBUG() << "FilterItems: reason(" << refresh_reason_ << ")," << changes.size() << "locations changed";
+    Items matched;
+    // Whatever matched in the other locations still does
+    for (const auto &item : items_) {
+        if (!changes.count(item->location()))
+            matched.push_back(item);
+    }
+    Items changed;
+    for (const auto &pair : changes)
+        changed.insert(changed.end(), pair.second.items.begin(), pair.second.items.end());
+    OrderFilters(changed, nullptr, &filters);
+    for (const auto &item : changed) {
+        if (MatchesAll(item, filters))
+            matched.push_back(item);
+    }
+    items_ = std::move(matched);
+    filtered_buyouts_ = bo_manager_.generation();
+
+    UpdateItemCounts(columns.items());
+    UpdateBuckets();
+}
+
+std::vector<FilterData*> Search::ActiveFilters() const {
+    std::vector<FilterData*> active;
+    for (auto &filter : filters_)
+        if (filter->IsActive())
+            active.push_back(filter.get());
+    return active;
+}
+
+void Search::OrderFilters(const Items &items, const ItemColumns::Selection *selection, std::vector<FilterData*> *filters) {
+    if (filters->size() < 2)
+        return;
+    Items sample = SampleItems(items, selection);
+    if (sample.empty())
+        return;
+
+    QElapsedTimer timer;
+    for (auto filter : *filters) {
+        size_t passed = 0;
+        timer.start();
+        for (auto &item : sample)
+            passed += filter->Matches(item);
+        FilterStats measured;
+        measured.cost = static_cast<double>(timer.nsecsElapsed()) / sample.size();
+        measured.pass_rate = static_cast<double>(passed) / sample.size();
+
+        auto it = filter_stats_.find(filter);
+        if (it == filter_stats_.end()) {
+            filter_stats_[filter] = measured;
+        } else {
+            it->second.cost = (it->second.cost + measured.cost) / 2;
+            it->second.pass_rate = (it->second.pass_rate + measured.pass_rate) / 2;
+        }
+    }
+
+    // Checking a filter costs its cost for every item that gets to it and saves
+    // checking the rest for every item it drops: cheap filters which drop a lot go first.
+    auto rank = [this](FilterData *filter) {
+        const FilterStats &stats = filter_stats_[filter];
+        return stats.cost / std::max(1e-3, 1 - stats.pass_rate);
+    };
+    std::stable_sort(filters->begin(), filters->end(), [&rank](FilterData *a, FilterData *b) {
+        return rank(a) < rank(b);
+    });
+}
+
+void Search::UpdateBuckets() {
     // Single bucket with null location is used to view all items at once
     bucket_.clear();
     bucket_.push_back(std::make_unique<Bucket>(ItemLocation()));
-
+    bucket_.front()->AddItems(items_);
+
+    // Every chunk groups its items by location, then each location's bucket
+    // collects its part of every chunk, in order.
+    auto chunks = MakeChunks<BucketChunk>(items_.size());
+    RunParallel(chunks, [this](BucketChunk &chunk) {
+        for (size_t i = chunk.begin; i < chunk.end; ++i)
+            chunk.tabs[items_[i]->location()].push_back(items_[i]);
+    });
     std::map<ItemLocation, std::unique_ptr<Bucket>> bucketed_tabs;
-    for (const auto &item : items_) {
-        ItemLocation location = item->location();
-        if (!bucketed_tabs.count(location))
-            bucketed_tabs[location] = std::make_unique<Bucket>(location);
-        bucketed_tabs[location]->AddItem(item);        
-        bucket_.front()->AddItem(item);
+    std::vector<Bucket*> filled;
+    for (auto &chunk : chunks) {
+        for (auto &pair : chunk.tabs) {
+            auto &bucket = bucketed_tabs[pair.first];
+            if (!bucket) {
+                bucket = std::make_unique<Bucket>(pair.first);
+                filled.push_back(bucket.get());
+            }
+        }
     }
+    RunParallel(filled, [&chunks](Bucket *bucket) {
+        for (auto &chunk : chunks) {
+            auto it = chunk.tabs.find(bucket->location());
+            if (it != chunk.tabs.end())
+                bucket->AddItems(it->second);
+        }
+    });
 
     // We need to add empty tabs here as there are no items to force their addition
     // But only do so if no filters are active as we want to hide empty tabs when
@@ -151,8 +370,9 @@ void Search::FilterItems(const Items &items) {
     for (auto &element : bucketed_tabs)
         buckets_.push_back(std::move(element.second));
 
-    // Let the model know that current sort order has been invalidated
+    // Let the model know that current sort order and shown values have been invalidated
     model_->SetSorted(false);
+    model_->InvalidateCache();
 }
 
 QString Search::GetCaption() {
@@ -194,9 +414,11 @@ int Search::GetItemsCount() {
     return filtered_item_count_total_;
 }
 
-void Search::Activate(const Items &items) {
+void Search::Activate(const ItemColumns &columns) {
     FromForm();
-    FilterItems(items);
+    // Already up to date if items were just refreshed, see FilterItems(items, changes)
+    if (refresh_reason_ != RefreshReason::ItemsChanged)
+        FilterItems(columns);
     view_->setSortingEnabled(false);
     view_->setModel(model_.get());
     view_->header()->setSortIndicator(model_->GetSortColumn(), model_->GetSortOrder());
@@ -19,11 +19,13 @@
 
 #pragma once
 
+#include <map>
 #include <memory>
 #include <vector>
 #include <set>
 
 #include "item.h"
+#include "itemcolumns.h"
 #include "column.h"
 #include "bucket.h"
 #include "util.h"
@@ -44,7 +46,10 @@ public:
 
 public:
     Search(BuyoutManager &bo, const std::string &caption, const std::vector<std::unique_ptr<Filter>> &filters, QTreeView *view);
-    void FilterItems(const Items &items);
+    void FilterItems(const ItemColumns &columns);
+    // Filters again only the items of locations that changed, unless buyouts changed
+    // too and a filter looks at them
+    void FilterItems(const ItemColumns &columns, const ItemsChangeSet &changes);
     void FromForm();
     void ToForm();
     void ResetForm();
@@ -56,7 +61,7 @@ public:
     int GetItemsCount();
     bool IsAnyFilterActive() const;
     // Sets this search as current, will display items in passed QTreeView.
-    void Activate(const Items &items);
+    void Activate(const ItemColumns &columns);
     void RestoreViewProperties();
     void SaveViewProperties();
     ItemLocation GetTabLocation(const QModelIndex & index) const;
@@ -65,9 +70,33 @@ public:
     const std::unique_ptr<Bucket> &bucket(int row) const;
     void SetRefreshReason(RefreshReason::Type reason) { refresh_reason_ = reason;};
 private:
+    // What a filter was measured to cost per item and how many items it lets through
+    struct FilterStats {
+        double cost;
+        double pass_rate;
+    };
+
     void UpdateItemCounts(const Items &items);
+    // True if the current filters can only drop items from the ones found with
+    // the previous filters, changed gets the filters that need to be checked again.
+    bool CanNarrow(const ItemColumns &columns, std::vector<FilterData*> *changed) const;
+    // Sorts filtered items into per-tab buckets
+    void UpdateBuckets();
+    // Filters the user has filled in, the others match every item
+    std::vector<FilterData*> ActiveFilters() const;
+    // Runs filters over a sample of the items (those in selection if it's given)
+    // and orders them so that the cheapest and most selective go first.
+    void OrderFilters(const Items &items, const ItemColumns::Selection *selection, std::vector<FilterData*> *filters);
 
     std::vector<std::unique_ptr<FilterData>> filters_;
+    // Copy of filters_ as they were when items_ was last filtered from all items
+    // of columns with that generation.
+    std::vector<FilterData> filtered_with_;
+    unsigned filtered_generation_{0};
+    // BuyoutManager::generation() when items_ was last filtered
+    unsigned filtered_buyouts_{0};
+    // Remembered across searches so that one unlucky sample doesn't decide the order
+    std::map<const FilterData*, FilterStats> filter_stats_;
     std::vector<std::unique_ptr<Column>> columns_;
     std::string caption_;
     Items items_;
@@ -25,6 +25,8 @@
 #include <ctime>
 #include <stdexcept>
 
+#include "QsLog.h"
+
 #include "currencymanager.h"
 
 SqliteDataStore::SqliteDataStore(const std::string &filename) :
@@ -38,6 +40,10 @@ SqliteDataStore::SqliteDataStore(const std::string &filename) :
     }
     CreateTable("data", "key TEXT PRIMARY KEY, value BLOB");
     CreateTable("currency", "timestamp INTEGER PRIMARY KEY, value TEXT");
+    // Items of a location are read back in rowid order, which is the order they were inserted in
+    CreateTable("items", "location TEXT NOT NULL, hash TEXT NOT NULL, json BLOB");
+    CreateIndex("items_location", "items", "location");
+    CreateIndex("items_hash", "items", "hash");
 }
 
 void SqliteDataStore::CreateTable(const std::string &name, const std::string &fields) {
@@ -47,6 +53,13 @@ void SqliteDataStore::CreateTable(const std::string &name, const std::string &fi
     }
 }
 
+void SqliteDataStore::CreateIndex(const std::string &name, const std::string &table, const std::string &fields) {
+    std::string query = "CREATE INDEX IF NOT EXISTS " + name + " ON " + table + "(" + fields + ")";
+    if (sqlite3_exec(db_, query.c_str(), 0, 0, 0) != SQLITE_OK) {
+        throw std::runtime_error("Failed to create index " + name + ".");
+    }
+}
+
 std::string SqliteDataStore::Get(const std::string &key, const std::string &default_value) {
     std::string query = "SELECT value FROM data WHERE key = ?";
     sqlite3_stmt *stmt;
@@ -94,6 +107,73 @@ std::vector<CurrencyUpdate> SqliteDataStore::GetAllCurrency() {
     return result;
 }
 
+bool SqliteDataStore::SetItems(const std::string &location, const std::vector<ItemRecord> &items) {
+    // Without a transaction every insert would be synced to disk separately
+    if (sqlite3_exec(db_, "BEGIN TRANSACTION", 0, 0, 0) != SQLITE_OK) {
+        QLOG_ERROR() << "Failed to store the items of" << location.c_str() << ":" << sqlite3_errmsg(db_);
+        return false;
+    }
+    if (ReplaceItems(location, items) && sqlite3_exec(db_, "COMMIT", 0, 0, 0) == SQLITE_OK)
+        return true;
+    // Committing now would keep the DELETE without the rows that replace it
+    QLOG_ERROR() << "Failed to store the items of" << location.c_str() << ":" << sqlite3_errmsg(db_);
+    sqlite3_exec(db_, "ROLLBACK", 0, 0, 0);
+    return false;
+}
+
+bool SqliteDataStore::ReplaceItems(const std::string &location, const std::vector<ItemRecord> &items) {
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare(db_, "DELETE FROM items WHERE location = ?", -1, &stmt, 0) != SQLITE_OK)
+        return false;
+    sqlite3_bind_text(stmt, 1, location.c_str(), -1, SQLITE_STATIC);
+    bool ok = sqlite3_step(stmt) == SQLITE_DONE;
+    sqlite3_finalize(stmt);
+    if (!ok)
+        return false;
+
+    if (sqlite3_prepare(db_, "INSERT INTO items (location, hash, json) VALUES (?, ?, ?)", -1, &stmt, 0) != SQLITE_OK)
+        return false;
+    for (auto &item : items) {
+        sqlite3_bind_text(stmt, 1, location.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt, 2, item.hash.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_blob(stmt, 3, item.json.c_str(), item.json.size(), SQLITE_STATIC);
+        if (sqlite3_step(stmt) != SQLITE_DONE) {
+            ok = false;
+            break;
+        }
+        sqlite3_reset(stmt);
+    }
+    sqlite3_finalize(stmt);
+    return ok;
+}
+
+std::vector<ItemRecord> SqliteDataStore::GetItems(const std::string &location) {
+    std::string query = "SELECT hash, json FROM items WHERE location = ? ORDER BY rowid ASC";
+    sqlite3_stmt *stmt;
+    sqlite3_prepare(db_, query.c_str(), -1, &stmt, 0);
+    sqlite3_bind_text(stmt, 1, location.c_str(), -1, SQLITE_STATIC);
+    std::vector<ItemRecord> result;
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        ItemRecord item;
+        item.hash = std::string(reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0)));
+        item.json = std::string(static_cast<const char*>(sqlite3_column_blob(stmt, 1)), sqlite3_column_bytes(stmt, 1));
+        result.push_back(item);
+    }
+    sqlite3_finalize(stmt);
+    return result;
+}
+
+std::vector<std::string> SqliteDataStore::GetItemLocations() {
+    std::string query = "SELECT DISTINCT location FROM items ORDER BY location ASC";
+    sqlite3_stmt *stmt;
+    sqlite3_prepare(db_, query.c_str(), -1, &stmt, 0);
+    std::vector<std::string> result;
+    while (sqlite3_step(stmt) == SQLITE_ROW)
+        result.push_back(reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0)));
+    sqlite3_finalize(stmt);
+    return result;
+}
+
 void SqliteDataStore::SetBool(const std::string &key, bool value) {
     SetInt(key, static_cast<int>(value));
 }
@@ -36,6 +36,9 @@ public:
     std::string Get(const std::string &key, const std::string &default_value = "");
     void InsertCurrencyUpdate(const CurrencyUpdate &update);
     std::vector<CurrencyUpdate> GetAllCurrency();
+    bool SetItems(const std::string &location, const std::vector<ItemRecord> &items);
+    std::vector<ItemRecord> GetItems(const std::string &location);
+    std::vector<std::string> GetItemLocations();
     void SetBool(const std::string &key, bool value);
     bool GetBool(const std::string &key, bool default_value = false);
     void SetInt(const std::string &key, int value);
@@ -43,6 +46,9 @@ public:
     static std::string MakeFilename(const std::string &name, const std::string &league);
 private:
     void CreateTable(const std::string &name, const std::string &fields);
+    void CreateIndex(const std::string &name, const std::string &table, const std::string &fields);
+    // The statements of SetItems, without the transaction
+    bool ReplaceItems(const std::string &location, const std::vector<ItemRecord> &items);
 
     std::string filename_;
     sqlite3 *db_;
@@ -114,6 +114,10 @@ void TabCache::AddManualRefresh( const ItemLocation &location) {
         manual_refresh_.insert(location.GetUniqueHash());
 }
 
+bool TabCache::IsCached(const QUrl &url) {
+    QNetworkCacheMetaData meta_data = metaData(url);
+    return meta_data.isValid() && meta_data.expirationDate() > QDateTime::currentDateTime();
+}
 
 void TabCache::OnItemsRefreshed() {
     // Clear any manually set tabs here
@@ -33,6 +33,8 @@ public:
 
     QNetworkRequest Request(const QUrl & url, const ItemLocation &loc, Flags flags = None);
     void AddManualRefresh(const ItemLocation &loc);
+    // True if a request for this url is going to be served from the cache
+    bool IsCached(const QUrl &url);
 
     QIODevice *prepare(const QNetworkCacheMetaData &metaData);
 
@@ -0,0 +1,78 @@
+/*
+    Copyright 2016 Ilya Zhuravlev
+
+    This file is part of Acquisition.
+
+    Acquisition is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Acquisition is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Acquisition.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "trigramindex.h"
+
+#include <algorithm>
+#include <cctype>
+#include <iterator>
+
+std::string TrigramIndex::Lowercase(const std::string &text) {
+    std::string result(text);
+    std::transform(result.begin(), result.end(), result.begin(), ::tolower);
+    return result;
+}
+
+void TrigramIndex::Trigrams(const std::string &lowercase, std::vector<Trigram> *trigrams) {
+    trigrams->clear();
+    for (size_t i = 0; i + 3 <= lowercase.size(); ++i) {
+        trigrams->push_back(static_cast<unsigned char>(lowercase[i]) << 16
+            | static_cast<unsigned char>(lowercase[i + 1]) << 8
+            | static_cast<unsigned char>(lowercase[i + 2]));
+    }
+    std::sort(trigrams->begin(), trigrams->end());
+    trigrams->erase(std::unique(trigrams->begin(), trigrams->end()), trigrams->end());
+}
+
+void TrigramIndex::Add(uint32_t id, const std::string &text) {
+    std::vector<Trigram> trigrams;
+    Trigrams(Lowercase(text), &trigrams);
+    for (auto trigram : trigrams)
+        postings_[trigram].push_back(id);
+}
+
+bool TrigramIndex::Candidates(const std::string &query, std::vector<uint32_t> *candidates) const {
+    candidates->clear();
+    std::vector<Trigram> trigrams;
+    Trigrams(Lowercase(query), &trigrams);
+    if (trigrams.empty())
+        return false;
+
+    std::vector<const std::vector<uint32_t>*> lists;
+    for (auto trigram : trigrams) {
+        auto it = postings_.find(trigram);
+        // Nothing contains this part of the query
+        if (it == postings_.end())
+            return true;
+        lists.push_back(&it->second);
+    }
+    // Starting with the shortest list keeps the intermediate results small
+    std::sort(lists.begin(), lists.end(), [](const std::vector<uint32_t> *a, const std::vector<uint32_t> *b) {
+        return a->size() < b->size();
+    });
+    *candidates = *lists.front();
+    std::vector<uint32_t> next;
+    for (size_t i = 1; i < lists.size() && !candidates->empty(); ++i) {
+        next.clear();
+        std::set_intersection(candidates->begin(), candidates->end(), lists[i]->begin(), lists[i]->end(),
+            std::back_inserter(next));
+        candidates->swap(next);
+    }
+    return true;
+}
@@ -0,0 +1,49 @@
+/*
+    Copyright 2016 Ilya Zhuravlev
+
+    This file is part of Acquisition.
+
+    Acquisition is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Acquisition is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Acquisition.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/*
+ * TrigramIndex maps every three character sequence of some texts to the
+ * (ascending) ids of the texts it appears in.
+ *
+ * A text containing a query contains all of its trigrams, so intersecting their
+ * posting lists gives a short list of candidates which then only have to be
+ * checked with a plain substring search. Matching is case insensitive (ASCII).
+ */
+class TrigramIndex {
+public:
+    // Ids must be added in increasing order
+    void Add(uint32_t id, const std::string &text);
+    // Fills candidates with ids of texts which may contain query, returns false if
+    // the query is too short for the index to tell (every text is a candidate then).
+    bool Candidates(const std::string &query, std::vector<uint32_t> *candidates) const;
+
+    static std::string Lowercase(const std::string &text);
+private:
+    typedef uint32_t Trigram;
+    static void Trigrams(const std::string &lowercase, std::vector<Trigram> *trigrams);
+
+    std::unordered_map<Trigram, std::vector<uint32_t>> postings_;
+};
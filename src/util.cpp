@@ -42,6 +42,15 @@ std::string Util::Md5(const std::string &value) {
     return hash.toUtf8().constData();
 }
 
+quint64 Util::FastHash(const char *data, size_t size) {
+    quint64 hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
 double Util::AverageDamage(const std::string &s) {
     size_t x = s.find("-");
     if (x == std::string::npos)
@@ -58,6 +58,8 @@ QDebug& operator<<(QDebug& os, const RefreshReason::Type& obj);
 
 namespace Util {
 std::string Md5(const std::string &value);
+// FNV-1a, for telling whether data has changed. Not for anything security related.
+quint64 FastHash(const char *data, size_t size);
 double AverageDamage(const std::string &s);
 void PopulateBuyoutTypeComboBox(QComboBox *combobox);
 void PopulateBuyoutCurrencyComboBox(QComboBox *combobox);
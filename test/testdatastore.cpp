@@ -0,0 +1,87 @@
+/*
+    Copyright 2016 Ilya Zhuravlev
+
+    This file is part of Acquisition.
+
+    Acquisition is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Acquisition is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Acquisition.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "testdatastore.h"
+
+#include <QTemporaryDir>
+
+#include "sqlite/sqlite3.h"
+#include "sqlitedatastore.h"
+
+void TestDataStore::SetItems() {
+    QTemporaryDir dir;
+    SqliteDataStore data(dir.path().toStdString() + "/data");
+
+    QVERIFY(data.SetItems("stash:1", { { "a", "{\"name\":\"First\"}" }, { "b", "{\"name\":\"Second\"}" } }));
+    QVERIFY(data.SetItems("stash:2", { { "c", "{\"name\":\"Third\"}" } }));
+
+    auto locations = data.GetItemLocations();
+    QCOMPARE(locations.size(), static_cast<size_t>(2));
+    QCOMPARE(locations[0].c_str(), "stash:1");
+    QCOMPARE(locations[1].c_str(), "stash:2");
+
+    // items come back in the order they were stored in
+    auto items = data.GetItems("stash:1");
+    QCOMPARE(items.size(), static_cast<size_t>(2));
+    QCOMPARE(items[0].hash.c_str(), "a");
+    QCOMPARE(items[0].json.c_str(), "{\"name\":\"First\"}");
+    QCOMPARE(items[1].hash.c_str(), "b");
+    QCOMPARE(data.GetItems("stash:3").size(), static_cast<size_t>(0));
+}
+
+void TestDataStore::ReplaceItems() {
+    QTemporaryDir dir;
+    SqliteDataStore data(dir.path().toStdString() + "/data");
+
+    data.SetItems("stash:1", { { "a", "{}" }, { "b", "{}" } });
+    data.SetItems("stash:2", { { "c", "{}" } });
+    data.SetItems("stash:1", { { "d", "{}" } });
+
+    auto items = data.GetItems("stash:1");
+    QCOMPARE(items.size(), static_cast<size_t>(1));
+    QCOMPARE(items[0].hash.c_str(), "d");
+    // other locations are left alone
+    QCOMPARE(data.GetItems("stash:2").size(), static_cast<size_t>(1));
+
+    data.SetItems("stash:1", {});
+    QCOMPARE(data.GetItems("stash:1").size(), static_cast<size_t>(0));
+    QCOMPARE(data.GetItemLocations().size(), static_cast<size_t>(1));
+}
+
+void TestDataStore::FailedSetItems() {
+    QTemporaryDir dir;
+    std::string filename = dir.path().toStdString() + "/data";
+    SqliteDataStore data(filename);
+    QVERIFY(data.SetItems("stash:1", { { "a", "{}" }, { "b", "{}" } }));
+
+    // Another connection holding the database makes the writes fail
+    sqlite3 *other;
+    QCOMPARE(sqlite3_open(filename.c_str(), &other), SQLITE_OK);
+    QCOMPARE(sqlite3_exec(other, "BEGIN EXCLUSIVE", 0, 0, 0), SQLITE_OK);
+    QVERIFY(!data.SetItems("stash:1", { { "c", "{}" } }));
+    sqlite3_exec(other, "COMMIT", 0, 0, 0);
+    sqlite3_close(other);
+
+    // Nothing was lost and nothing was left half done
+    auto items = data.GetItems("stash:1");
+    QCOMPARE(items.size(), static_cast<size_t>(2));
+    QCOMPARE(items[0].hash.c_str(), "a");
+    QVERIFY(data.SetItems("stash:1", { { "c", "{}" } }));
+    QCOMPARE(data.GetItems("stash:1").size(), static_cast<size_t>(1));
+}
@@ -0,0 +1,114 @@
+/*
+    Copyright 2016 Ilya Zhuravlev
+
+    This file is part of Acquisition.
+
+    Acquisition is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Acquisition is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Acquisition.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "testfilters.h"
+
+#include <QVBoxLayout>
+#include <QWidget>
+
+#include "filters.h"
+#include "modsfilter.h"
+
+static ModFilterData Bounds(const char *mod, double min, double max, bool min_filled, bool max_filled) {
+    return ModFilterData(mod, min, max, min_filled, max_filled);
+}
+
+void TestFilters::BoundsNarrow() {
+    auto range = Bounds("", 10, 20, true, true);
+
+    QVERIFY(::BoundsNarrow(range, range));
+    QVERIFY(::BoundsNarrow(range, Bounds("", 12, 18, true, true)));
+    // Loosened on either side
+    QVERIFY(!::BoundsNarrow(range, Bounds("", 5, 20, true, true)));
+    QVERIFY(!::BoundsNarrow(range, Bounds("", 10, 25, true, true)));
+    // Cleared on either side
+    QVERIFY(!::BoundsNarrow(range, Bounds("", 10, 20, false, true)));
+    QVERIFY(!::BoundsNarrow(range, Bounds("", 10, 20, true, false)));
+    // Only one side filled: the other side can be anything
+    auto min_only = Bounds("", 10, 0, true, false);
+    QVERIFY(::BoundsNarrow(min_only, Bounds("", 15, 0, true, false)));
+    QVERIFY(::BoundsNarrow(min_only, Bounds("", 10, 1, true, true)));
+    QVERIFY(!::BoundsNarrow(min_only, Bounds("", 5, 0, true, false)));
+    QVERIFY(!::BoundsNarrow(min_only, Bounds("", 0, 100, false, true)));
+    auto max_only = Bounds("", 0, 20, false, true);
+    QVERIFY(::BoundsNarrow(max_only, Bounds("", 0, 15, false, true)));
+    QVERIFY(!::BoundsNarrow(max_only, Bounds("", 0, 25, false, true)));
+    // Filling a bound that was empty only narrows
+    QVERIFY(::BoundsNarrow(Bounds("", 0, 0, false, false), range));
+}
+
+void TestFilters::NameSearchNarrows() {
+    QWidget window;
+    NameSearchFilter filter(new QVBoxLayout(&window));
+    FilterData before(&filter), after(&filter);
+
+    before.text_query = "";
+    after.text_query = "ring";
+    QVERIFY(filter.Narrows(before, after));
+
+    before.text_query = "ring";
+    after.text_query = "ruby ring";
+    QVERIFY(filter.Narrows(before, after));
+    // Case is folded the same way Matches does
+    after.text_query = "RING";
+    QVERIFY(filter.Narrows(before, after));
+    after.text_query = "Ruby Ring";
+    QVERIFY(filter.Narrows(before, after));
+    // Shortened or replaced queries can match more
+    after.text_query = "rin";
+    QVERIFY(!filter.Narrows(before, after));
+    after.text_query = "amulet";
+    QVERIFY(!filter.Narrows(before, after));
+    after.text_query = "";
+    QVERIFY(!filter.Narrows(before, after));
+}
+
+void TestFilters::ModsNarrows() {
+    QWidget window;
+    ModsFilter filter(new QVBoxLayout(&window));
+    FilterData before(&filter), after(&filter);
+
+    auto life = Bounds("+# to maximum Life", 50, 0, true, false);
+    auto mana = Bounds("+# to maximum Mana", 30, 0, true, false);
+
+    after.mod_data = { life };
+    QVERIFY(filter.Narrows(before, after));
+
+    before.mod_data = { life };
+    after.mod_data = { life, mana };
+    QVERIFY(filter.Narrows(before, after));
+    after.mod_data = { mana, Bounds("+# to maximum Life", 70, 0, true, false) };
+    QVERIFY(filter.Narrows(before, after));
+    // Loosened
+    after.mod_data = { Bounds("+# to maximum Life", 40, 0, true, false) };
+    QVERIFY(!filter.Narrows(before, after));
+    // Removed
+    after.mod_data.clear();
+    QVERIFY(!filter.Narrows(before, after));
+    // Swapped for another mod
+    after.mod_data = { mana };
+    QVERIFY(!filter.Narrows(before, after));
+    before.mod_data = { life, mana };
+    after.mod_data = { life };
+    QVERIFY(!filter.Narrows(before, after));
+    // Mods left empty in the form don't filter anything
+    before.mod_data = { Bounds("", 0, 0, false, false) };
+    after.mod_data.clear();
+    QVERIFY(filter.Narrows(before, after));
+}
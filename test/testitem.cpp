@@ -22,7 +22,27 @@
 #include "rapidjson/document.h"
 
 #include "item.h"
+#include "itemarena.h"
+#include "itemparser.h"
+#include "itemsmanagerworker.h"
+#include "itemsnapshot.h"
+#include "modlist.h"
+#include "rapidjson_util.h"
 #include "testdata.h"
+#include "util.h"
+
+// What ItemsManagerWorker did before ItemParser existed
+static void ParseItemsDom(rapidjson::Value *value_ptr, const ItemLocation &base_location, rapidjson_allocator &alloc, Items *items) {
+    for (auto &json : *value_ptr) {
+        ItemLocation location(base_location);
+        location.FromItemJson(json);
+        location.ToItemJson(&json, alloc);
+        items->push_back(std::make_shared<Item>(json));
+        location.set_socketed(true);
+        if (json.HasMember("socketedItems"))
+            ParseItemsDom(&json["socketedItems"], location, alloc, items);
+    }
+}
 
 void TestItem::Parse() {
     rapidjson::Document doc;
@@ -42,3 +62,207 @@ void TestItem::Parse() {
     // This needs to match so that item hash migration is successful
     QCOMPARE(item.old_hash().c_str(), "5f083f2f5ceb10ed720bd4c1771ed09d");
 }
+
+void TestItem::StreamingParse() {
+    std::string reply = "{\"numTabs\":2,\"items\":[" + kItem1 + "," + kSocketedItem + "]}";
+    ItemLocation location(1, "Tab", ItemLocationType::STASH);
+
+    rapidjson::Document doc;
+    doc.Parse(reply.c_str());
+    Items expected;
+    ParseItemsDom(&doc["items"], location, doc.GetAllocator(), &expected);
+
+    Items items;
+    ItemParser parser(location, &items);
+    QVERIFY(parser.Parse(QByteArray(reply.c_str())));
+    QVERIFY(!parser.error());
+
+    QCOMPARE(items.size(), expected.size());
+    for (size_t i = 0; i < items.size(); ++i) {
+        auto &item = *items[i];
+        auto &other = *expected[i];
+        // the parser keeps the json as it was received, so only the contents have to match
+        rapidjson::Document json, other_json;
+        json.Parse(item.json().c_str());
+        other_json.Parse(other.json().c_str());
+        QVERIFY(json == other_json);
+        QCOMPARE(item.hash(), other.hash());
+        QCOMPARE(item.old_hash(), other.old_hash());
+        QCOMPARE(item.PrettyName(), other.PrettyName());
+        QCOMPARE(item.count(), other.count());
+        QCOMPARE(item.links_cnt(), other.links_cnt());
+        QCOMPARE(item.socket_groups().size(), other.socket_groups().size());
+        QCOMPARE(item.properties(), other.properties());
+        QCOMPARE(item.requirements(), other.requirements());
+        QVERIFY(item.mod_table() == other.mod_table());
+        QCOMPARE(item.location().GetUniqueHash(), other.location().GetUniqueHash());
+        QCOMPARE(item.location().socketed(), other.location().socketed());
+        QCOMPARE(item.location().GetRect(), other.location().GetRect());
+    }
+
+    Items none;
+    ItemParser error_parser(location, &none);
+    QVERIFY(error_parser.Parse(QByteArray("{\"error\":{\"message\":\"Forbidden\"}}")));
+    QVERIFY(error_parser.error());
+    ItemParser array_parser(location, &none);
+    QVERIFY(!array_parser.Parse(QByteArray("[]")));
+}
+
+void TestItem::StoreAndLoad() {
+    std::string reply = "{\"items\":[" + kItem1 + "," + kSocketedItem + "]}";
+    ItemLocation location(1, "Tab", ItemLocationType::STASH);
+    Items items;
+    ItemParser parser(location, &items);
+    QVERIFY(parser.Parse(QByteArray(reply.c_str())));
+
+    // this is what ItemsManagerWorker loads for a location from the items table
+    std::string stored = "[";
+    for (auto &item : items) {
+        if (stored.size() > 1)
+            stored += ",";
+        item->AppendJson(&stored);
+    }
+    stored += "]";
+
+    Items loaded;
+    ItemParser stored_parser(ItemLocation(), &loaded);
+    QVERIFY(stored_parser.ParseStored(QByteArray::fromStdString(stored)));
+
+    QCOMPARE(loaded.size(), items.size());
+    for (size_t i = 0; i < items.size(); ++i) {
+        // the location fields must not pile up
+        QCOMPARE(loaded[i]->json(), items[i]->json());
+        QVERIFY(loaded[i]->raw_json() == items[i]->raw_json());
+        QCOMPARE(loaded[i]->hash(), items[i]->hash());
+        QCOMPARE(loaded[i]->location().GetUniqueHash(), items[i]->location().GetUniqueHash());
+        QCOMPARE(loaded[i]->location().socketed(), items[i]->location().socketed());
+    }
+}
+
+void TestItem::Snapshot() {
+    std::string reply = "{\"items\":[" + kItem1 + "," + kSocketedItem + "]}";
+    ItemLocation location(1, "Tab", ItemLocationType::STASH);
+    Items items;
+    ItemParser parser(location, &items);
+    QVERIFY(parser.Parse(QByteArray(reply.c_str())));
+
+    QByteArray snapshot = ItemSnapshot::Write(items, "1");
+    Items loaded;
+    QVERIFY(ItemSnapshot::Read(snapshot, "1", &loaded));
+    QCOMPARE(loaded.size(), items.size());
+    for (size_t i = 0; i < items.size(); ++i) {
+        auto &item = *loaded[i];
+        auto &other = *items[i];
+        QCOMPARE(item.json(), other.json());
+        QVERIFY(item.raw_json() == other.raw_json());
+        QCOMPARE(item.hash(), other.hash());
+        QCOMPARE(item.old_hash(), other.old_hash());
+        QCOMPARE(item.PrettyName(), other.PrettyName());
+        QCOMPARE(item.properties(), other.properties());
+        QCOMPARE(item.requirements(), other.requirements());
+        QCOMPARE(item.text_mods(), other.text_mods());
+        QCOMPARE(item.text_properties().size(), other.text_properties().size());
+        QCOMPARE(item.sockets_cnt(), other.sockets_cnt());
+        QCOMPARE(item.socket_groups().size(), other.socket_groups().size());
+        QVERIFY(item.mod_table() == other.mod_table());
+        QCOMPARE(item.location().GetRect(), other.location().GetRect());
+        QCOMPARE(item.location().GetUniqueHash(), other.location().GetUniqueHash());
+    }
+
+    // A snapshot that doesn't match the items table must not be used
+    Items none;
+    QVERIFY(!ItemSnapshot::Read(snapshot, "2", &none));
+    QVERIFY(!ItemSnapshot::Read(snapshot.left(snapshot.size() - 1), "1", &none));
+    // Mod ids would mean other mods
+    mod_names.Add("Snapshot test mod");
+    QVERIFY(!ItemSnapshot::Read(snapshot, "1", &none));
+    QVERIFY(none.empty());
+}
+
+// The test item moved to another stash tab
+static std::string InTab(const std::string &json, int tab) {
+    rapidjson::Document doc;
+    doc.Parse(json.c_str());
+    doc["_tab"].SetInt(tab);
+    return Util::RapidjsonSerialize(doc);
+}
+
+static QByteArray TabReply(int tab) {
+    return QByteArray::fromStdString("{\"items\":[" + InTab(kItem1, tab) + "," + InTab(kSocketedItem, tab) + "]}");
+}
+
+void TestItem::Arenas() {
+    ItemLocation first(1, "First", ItemLocationType::STASH);
+    ItemLocation second(2, "Second", ItemLocationType::STASH);
+    int before = ItemArena::live_count();
+
+    // What the worker has after loading the snapshot at startup
+    Items loaded;
+    {
+        Items parsed;
+        ItemParser first_parser(first, &parsed);
+        QVERIFY(first_parser.Parse(TabReply(1)));
+        ItemParser second_parser(second, &parsed);
+        QVERIFY(second_parser.Parse(TabReply(2)));
+        QVERIFY(ItemSnapshot::Read(ItemSnapshot::Write(parsed, "1"), "1", &loaded));
+    }
+    // one per location
+    QCOMPARE(ItemArena::live_count(), before + 2);
+    Items first_items, second_items;
+    for (auto &item : loaded)
+        (item->location().get_tab_id() == 1 ? first_items : second_items).push_back(item);
+    loaded.clear();
+
+    // A refresh finds an item gone from the first location
+    Items received;
+    {
+        ItemParser parser(first, &received);
+        QVERIFY(parser.Parse(QByteArray::fromStdString("{\"items\":[" + InTab(kItem1, 1) + "]}")));
+    }
+    TabChanges tab;
+    QVERIFY(ItemsManagerWorker::DiffItems(first_items, received, &tab));
+    QVERIFY(tab.items == received);
+    QVERIFY(!tab.removed.empty());
+
+    std::weak_ptr<Item> previous = first_items.front();
+    first_items = tab.items;
+    tab = TabChanges();
+    received.clear();
+    // Nothing is left of the first location's snapshot arena. The control blocks are
+    // in the arena too, so even a weak_ptr keeps it alive.
+    QVERIFY(previous.expired());
+    previous.reset();
+    QCOMPARE(ItemArena::live_count(), before + 2);
+
+    {
+        // Nothing changed, the instances the rest of the application has are kept
+        TabChanges same;
+        Items reversed(second_items.rbegin(), second_items.rend());
+        QVERIFY(!ItemsManagerWorker::DiffItems(second_items, reversed, &same));
+        QVERIFY(same.items == second_items);
+    }
+
+    first_items.clear();
+    second_items.clear();
+    QCOMPARE(ItemArena::live_count(), before);
+}
+
+void TestItem::Interning() {
+    InternedString a(std::string("Physical Damage"));
+    InternedString b("Physical Damage", 8);
+    QVERIFY(a == InternedString("Physical Damage"));
+    QVERIFY(a != b);
+    QCOMPARE(b.str(), std::string("Physical"));
+    QCOMPARE(a.hash(), InternedString("Physical Damage").hash());
+    QVERIFY(b < a);
+    QVERIFY(!(a < a));
+    QVERIFY(InternedString().empty());
+    QVERIFY(InternedString() == InternedString(""));
+
+    rapidjson::Document doc;
+    doc.Parse(kItem1.c_str());
+    Item first(doc), second(doc);
+    // Both items point to the same copy of their strings
+    QCOMPARE(&first.typeLine(), &second.typeLine());
+    QCOMPARE(first.text_mods(), second.text_mods());
+}
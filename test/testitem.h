@@ -26,4 +26,9 @@ class TestItem : public QObject
     Q_OBJECT
 private slots:
     void Parse();
+    void StreamingParse();
+    void StoreAndLoad();
+    void Snapshot();
+    void Arenas();
+    void Interning();
 };
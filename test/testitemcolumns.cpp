@@ -0,0 +1,140 @@
+/*
+    Copyright 2016 Ilya Zhuravlev
+
+    This file is part of Acquisition.
+
+    Acquisition is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Acquisition is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Acquisition.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "testitemcolumns.h"
+
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "itemcolumns.h"
+
+void TestItemColumns::Columns() {
+    Items items;
+    for (auto name : { "a", "bb", "ccc" })
+        items.push_back(std::make_shared<Item>(name, ItemLocation()));
+    ItemColumns columns(items);
+
+    int calls = 0;
+    auto length = [&calls](const std::shared_ptr<Item> &item) {
+        ++calls;
+        return static_cast<double>(item->name().size());
+    };
+    auto &column = columns.Get(this, 0, length);
+    QCOMPARE(column, ItemColumns::Column({ 1, 2, 3 }));
+    // Built only once
+    columns.Get(this, 0, length);
+    QCOMPARE(calls, 3);
+    // Other attributes get their own column
+    columns.Get(this, 1, length);
+    QCOMPARE(calls, 6);
+
+    items.pop_back();
+    columns.Reset();
+    QCOMPARE(columns.Get(this, 0, length), ItemColumns::Column({ 1, 2 }));
+    QCOMPARE(calls, 8);
+}
+
+void TestItemColumns::SelectRange() {
+    ItemColumns::Column column = { 1, 5, ItemColumns::Missing(), 10, 7 };
+    ItemColumns::Selection selection(column.size(), 1);
+
+    ItemColumns::SelectRange(column, 2, 100, &selection);
+    QCOMPARE(selection, ItemColumns::Selection({ 0, 1, 0, 1, 1 }));
+    ItemColumns::SelectRange(column, -1000, 7, &selection);
+    QCOMPARE(selection, ItemColumns::Selection({ 0, 1, 0, 0, 1 }));
+
+    // Missing values never match, even an unbounded range
+    selection.assign(column.size(), 1);
+    ItemColumns::SelectRange(column, -std::numeric_limits<double>::infinity(), std::numeric_limits<double>::infinity(), &selection);
+    QCOMPARE(selection, ItemColumns::Selection({ 1, 1, 0, 1, 1 }));
+}
+
+void TestItemColumns::SelectText() {
+    Items items;
+    for (auto name : { "Tabula Rasa", "Rare Belt", "Ra", "abcd bcde" })
+        items.push_back(std::make_shared<Item>(name, ItemLocation()));
+    ItemColumns columns(items);
+    auto name = [](const std::shared_ptr<Item> &item) { return item->name(); };
+
+    ItemColumns::Selection selection(items.size(), 1);
+    QVERIFY(columns.SelectText(this, name, "RAS", &selection));
+    QCOMPARE(selection, ItemColumns::Selection({ 1, 0, 0, 0 }));
+    // Candidates of the index are checked against the whole query
+    selection.assign(items.size(), 1);
+    QVERIFY(columns.SelectText(this, name, "abcde", &selection));
+    QCOMPARE(selection, ItemColumns::Selection({ 0, 0, 0, 0 }));
+    // Too short for the index, left to the search
+    selection.assign(items.size(), 1);
+    QVERIFY(!columns.SelectText(this, name, "ra", &selection));
+    QCOMPARE(selection, ItemColumns::Selection({ 1, 1, 1, 1 }));
+}
+
+void TestItemColumns::Sorted() {
+    Items items;
+    for (auto name : { "a", "bbbbb", "ccc", "", "dd" })
+        items.push_back(std::make_shared<Item>(name, ItemLocation()));
+    ItemColumns columns(items);
+    auto length = [](const std::shared_ptr<Item> &item) {
+        return item->name().empty() ? ItemColumns::Missing() : item->name().size();
+    };
+
+    auto &sorted = columns.GetSorted(this, 0, length);
+    QCOMPARE(sorted.values, std::vector<double>({ 1, 2, 3, 5 }));
+    QCOMPARE(sorted.ids, ItemColumns::Ids({ 0, 4, 2, 1 }));
+
+    ItemColumns::Ids ids;
+    ItemColumns::RangeIds(sorted, 2, 3, &ids);
+    QCOMPARE(ids, ItemColumns::Ids({ 2, 4 }));
+    ItemColumns::RangeIds(sorted, 6, 100, &ids);
+    QVERIFY(ids.empty());
+    ItemColumns::RangeIds(sorted, -std::numeric_limits<double>::infinity(), std::numeric_limits<double>::infinity(), &ids);
+    QCOMPARE(ids, ItemColumns::Ids({ 0, 1, 2, 4 }));
+
+    ItemColumns::Selection selection = { 1, 1, 0, 1, 1 };
+    ItemColumns::SelectIds({ 1, 2, 4 }, &selection);
+    QCOMPARE(selection, ItemColumns::Selection({ 0, 1, 0, 0, 1 }));
+    selection.assign(5, 1);
+    ItemColumns::SelectIds({ 0, 0, 3, 7 }, &selection);
+    QCOMPARE(selection, ItemColumns::Selection({ 1, 0, 0, 1, 0 }));
+    ItemColumns::SelectIds({}, &selection);
+    QCOMPARE(selection, ItemColumns::Selection({ 0, 0, 0, 0, 0 }));
+}
+
+void TestItemColumns::Facet() {
+    Items items;
+    for (auto name : { "a", "bb", "c", "dd" })
+        items.push_back(std::make_shared<Item>(name, ItemLocation()));
+    ItemColumns columns(items);
+    int calls = 0;
+    auto even = [&calls](const std::shared_ptr<Item> &item) {
+        ++calls;
+        return item->name().size() % 2 == 0;
+    };
+
+    auto &facet = columns.GetFacet(this, 0, even);
+    QCOMPARE(facet, ItemColumns::Selection({ 0, 1, 0, 1 }));
+    columns.GetFacet(this, 0, even);
+    QCOMPARE(calls, 4);
+
+    ItemColumns::Selection selection = { 1, 1, 1, 0 };
+    ItemColumns::SelectFacet(facet, &selection);
+    QCOMPARE(selection, ItemColumns::Selection({ 0, 1, 0, 0 }));
+}
@@ -219,3 +219,35 @@ void TestItemsManager::ItemHashMigration() {
     auto buyout_from_mgr = bo.Get(item);
     QVERIFY2(buyout_from_mgr == buyout, "After migration: the buyout must match our data");
 }
+
+// Checks that a refresh with a change set only touches the locations that changed
+void TestItemsManager::IncrementalRefresh() {
+    ItemLocation first_tab(1, "first");
+    ItemLocation second_tab(2, "second");
+    auto first = std::make_shared<Item>("First item", first_tab);
+    auto second = std::make_shared<Item>("Second item", second_tab);
+    auto second_moved = std::make_shared<Item>("Second item", first_tab);
+
+    auto &bo = app_.buyout_manager();
+    Buyout item_buyout(123.0, BUYOUT_TYPE_BUYOUT, CURRENCY_ORB_OF_ALTERATION, QDateTime::currentDateTime());
+    Buyout tab_buyout(456.0, BUYOUT_TYPE_BUYOUT, CURRENCY_CHAOS_ORB, QDateTime::currentDateTime());
+    bo.Set(*first, item_buyout);
+    bo.Set(*second, item_buyout);
+
+    std::vector<ItemLocation> tabs = { first_tab, second_tab };
+    app_.items_manager().OnItemsRefreshed({ first, second }, tabs, true);
+
+    // Remove the first item and move the second one to the first tab
+    bo.SetTab(first_tab.GetUniqueHash(), tab_buyout);
+    bo.SetTab(second_tab.GetUniqueHash(), tab_buyout);
+    ItemsChangeSet changes;
+    changes[first_tab].items = { second_moved };
+    changes[first_tab].added = { second_moved };
+    changes[first_tab].removed = { first };
+    changes[second_tab].removed = { second };
+    app_.items_manager().OnItemsRefreshed({ second_moved }, tabs, changes, false);
+
+    QVERIFY2(!bo.Get(*first).IsActive(), "The buyout of a removed item must be gone");
+    QVERIFY2(bo.Get(*second_moved) == item_buyout, "The buyout of a moved item must be kept");
+    QVERIFY2(app_.items_manager().changes().size() == 2, "Both locations must be reported as changed");
+}
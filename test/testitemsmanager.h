@@ -36,6 +36,7 @@ private slots:
     void MoveItemBoToNoBo();
     void MoveItemBoToBo();
     void ItemHashMigration();
+    void IncrementalRefresh();
 private:
     Application app_;
 };
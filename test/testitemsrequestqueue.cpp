@@ -0,0 +1,109 @@
+/*
+    Copyright 2016 Ilya Zhuravlev
+
+    This file is part of Acquisition.
+
+    Acquisition is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Acquisition is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Acquisition.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "testitemsrequestqueue.h"
+
+#include "itemsrequestqueue.h"
+
+const qint64 kNow = 1000000;
+
+static ItemsRequest MakeRequest(int id) {
+    ItemsRequest request;
+    request.id = id;
+    return request;
+}
+
+static int PopId(ItemsRequestQueue *queue, qint64 now) {
+    ItemsRequest request;
+    if (!queue->Pop(now, &request))
+        return -1;
+    return request.id;
+}
+
+void TestItemsRequestQueue::Priority() {
+    ItemsRequestQueue queue;
+    queue.Push(MakeRequest(0), ItemsRequestQueue::Refill);
+    queue.Push(MakeRequest(1), ItemsRequestQueue::Character);
+    queue.Push(MakeRequest(2), ItemsRequestQueue::Checked);
+    queue.Push(MakeRequest(3), ItemsRequestQueue::Urgent);
+    queue.Push(MakeRequest(4), ItemsRequestQueue::Checked);
+    QCOMPARE(queue.size(), static_cast<size_t>(5));
+
+    QCOMPARE(PopId(&queue, kNow), 3);
+    // Same priority goes in the order of queueing
+    QCOMPARE(PopId(&queue, kNow), 2);
+    QCOMPARE(PopId(&queue, kNow), 4);
+    QCOMPARE(PopId(&queue, kNow), 1);
+    QCOMPARE(PopId(&queue, kNow), 0);
+    QVERIFY(queue.empty());
+    QCOMPARE(PopId(&queue, kNow), -1);
+}
+
+void TestItemsRequestQueue::Retry() {
+    ItemsRequestQueue queue;
+    queue.Push(MakeRequest(0), ItemsRequestQueue::Urgent, kNow + 2000);
+    queue.Push(MakeRequest(1), ItemsRequestQueue::Urgent, kNow + 1000);
+    queue.Push(MakeRequest(2), ItemsRequestQueue::Checked);
+    QCOMPARE(queue.NextReady(), 0LL);
+
+    // Retries that aren't due don't hold up the rest
+    QCOMPARE(PopId(&queue, kNow), 2);
+    QCOMPARE(PopId(&queue, kNow), -1);
+    QCOMPARE(queue.NextReady(), kNow + 1000);
+
+    // The earlier deadline goes first
+    QCOMPARE(PopId(&queue, kNow + 5000), 1);
+    QCOMPARE(PopId(&queue, kNow + 5000), 0);
+}
+
+void TestItemsRequestQueue::Filter() {
+    ItemsRequestQueue queue;
+    queue.Push(MakeRequest(0), ItemsRequestQueue::Urgent);
+    queue.Push(MakeRequest(1), ItemsRequestQueue::Refill);
+
+    ItemsRequest request;
+    QVERIFY(queue.Pop(kNow, &request, [](const ItemsRequest &r) { return r.id == 1; }));
+    QCOMPARE(request.id, 1);
+    QVERIFY(!queue.Pop(kNow, &request, [](const ItemsRequest &r) { return r.id == 1; }));
+    QCOMPARE(PopId(&queue, kNow), 0);
+
+    queue.Push(MakeRequest(2), ItemsRequestQueue::Checked);
+    queue.Push(MakeRequest(3), ItemsRequestQueue::Checked);
+    queue.Push(MakeRequest(4), ItemsRequestQueue::Checked);
+    QCOMPARE(queue.RemoveIf([](const ItemsRequest &r) { return r.id % 2 == 0; }), 2);
+    QCOMPARE(PopId(&queue, kNow), 3);
+    QVERIFY(queue.empty());
+}
+
+void TestItemsRequestQueue::RetryDelay() {
+    QCOMPARE(ItemsRequestQueue::RetryDelay(1, 0.0), kRetryBaseDelay / 2);
+    QCOMPARE(ItemsRequestQueue::RetryDelay(1, 0.5), kRetryBaseDelay * 3 / 4);
+    QCOMPARE(ItemsRequestQueue::RetryDelay(2, 0.0), kRetryBaseDelay);
+    QCOMPARE(ItemsRequestQueue::RetryDelay(3, 0.0), kRetryBaseDelay * 2);
+    // Never more than the maximum, no matter how many times it failed
+    QCOMPARE(ItemsRequestQueue::RetryDelay(10, 0.0), kRetryMaxDelay / 2);
+    QCOMPARE(ItemsRequestQueue::RetryDelay(100, 0.0), kRetryMaxDelay / 2);
+    QVERIFY(ItemsRequestQueue::RetryDelay(100, 0.999) < kRetryMaxDelay);
+
+    ItemsRequestQueue queue;
+    queue.Push(MakeRequest(0), ItemsRequestQueue::Checked, kNow + 1000);
+    queue.Push(MakeRequest(1), ItemsRequestQueue::Checked);
+    QCOMPARE(queue.Waiting(kNow), 1);
+    QCOMPARE(queue.Waiting(kNow + 1000), 0);
+}
@@ -4,9 +4,17 @@
 #include <memory>
 
 #include "porting.h"
+#include "testdatastore.h"
+#include "testfilters.h"
 #include "testitem.h"
+#include "testitemcolumns.h"
 #include "testitemsmanager.h"
+#include "testitemsrequestqueue.h"
+#include "testmodlist.h"
+#include "testratelimiter.h"
+#include "testrefreshcheckpoint.h"
 #include "testshop.h"
+#include "testtrigramindex.h"
 #include "testutil.h"
 
 #define TEST(Class) result |= QTest::qExec(std::make_unique<Class>().get())
@@ -18,9 +26,17 @@ int test_main() {
     std::setlocale(LC_ALL, "C");
 
     TEST(TestItem);
+    TEST(TestItemColumns);
+    TEST(TestFilters);
     TEST(TestShop);
     TEST(TestUtil);
+    TEST(TestModlist);
     TEST(TestItemsManager);
+    TEST(TestItemsRequestQueue);
+    TEST(TestRateLimiter);
+    TEST(TestRefreshCheckpoint);
+    TEST(TestDataStore);
+    TEST(TestTrigramIndex);
 
     return result != 0 ? -1 : 0;
 }
@@ -0,0 +1,87 @@
+/*
+    Copyright 2016 Ilya Zhuravlev
+
+    This file is part of Acquisition.
+
+    Acquisition is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Acquisition is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Acquisition.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "testmodlist.h"
+
+#include <string>
+#include <vector>
+
+#include "modlist.h"
+#include "util.h"
+
+static const std::vector<std::vector<std::string>> kSums = {
+    { "+# to Strength", "+# to Strength and Dexterity", "+# to all Attributes" },
+    { "+# to all Attributes" },
+    { "Adds # Damage to Attacks", "Adds #-# Fire Damage", "Adds #-# Physical Damage" },
+    { "#% increased Attack Speed" },
+};
+
+void TestModlist::SumMods() {
+    ModNames names;
+    SumModGenerator generator(kSums, &names);
+    ModTable table;
+    for (auto mod : { "+10 to all Attributes", "+5 to Strength", "+3 to Strength and Dexterity",
+                      "Adds 1-3 Fire Damage", "Adds 2.5-7.5 Physical Damage", "+12 to maximum Life" })
+        generator.Match(mod, &table);
+
+    QCOMPARE(names.size(), kSums.size());
+    QCOMPARE(table.size(), static_cast<size_t>(3));
+    QCOMPARE(*table.Find(names.Find("+# to Strength")), 18.0);
+    QCOMPARE(*table.Find(names.Find("+# to all Attributes")), 10.0);
+    QCOMPARE(*table.Find(names.Find("Adds # Damage to Attacks")), 7.0);
+    QVERIFY(!table.Find(names.Find("#% increased Attack Speed")));
+    QVERIFY(!table.Find(names.Find("+# to maximum Life")));
+}
+
+// The compiled table has to give the same results as trying every template
+void TestModlist::SameAsMatchMod() {
+    ModNames names;
+    SumModGenerator generator(kSums, &names);
+    for (auto mod : { "+10 to all Attributes", "+1 to Strength", "+1 to Strengt", "Adds 1-2 Fire Damage",
+                      "Adds 1 Fire Damage", "15% increased Attack Speed", "+15% increased Attack Speed" }) {
+        ModTable compiled;
+        generator.Match(mod, &compiled);
+
+        ModTable expected;
+        for (auto &list : kSums) {
+            for (auto &match : list) {
+                double value;
+                if (Util::MatchMod(match.c_str(), mod, &value))
+                    expected.Add(names.Find(list[0]), value);
+            }
+        }
+        QVERIFY(compiled == expected);
+    }
+}
+
+void TestModlist::Table() {
+    ModTable table;
+    table.Add(5, 1.0);
+    table.Add(2, 3.0);
+    table.Add(9, 4.0);
+    table.Add(5, 0.5);
+    QCOMPARE(table.size(), static_cast<size_t>(3));
+    std::vector<int> ids;
+    for (auto &entry : table)
+        ids.push_back(entry.id);
+    QCOMPARE(ids, std::vector<int>({ 2, 5, 9 }));
+    QCOMPARE(*table.Find(5), 1.5);
+    QVERIFY(!table.Find(3));
+    QVERIFY(!table.Find(-1));
+}
@@ -0,0 +1,135 @@
+/*
+    Copyright 2016 Ilya Zhuravlev
+
+    This file is part of Acquisition.
+
+    Acquisition is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Acquisition is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Acquisition.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "testratelimiter.h"
+
+#include "memorydatastore.h"
+#include "ratelimiter.h"
+
+const qint64 kNow = 1000000;
+
+static RateLimiter::Headers MakeHeaders(const std::string &limit, const std::string &state) {
+    RateLimiter::Headers headers;
+    headers["x-rate-limit-policy"] = "test-policy";
+    headers["x-rate-limit-rules"] = "Ip";
+    headers["x-rate-limit-ip"] = limit;
+    headers["x-rate-limit-ip-state"] = state;
+    return headers;
+}
+
+void TestRateLimiter::DefaultLimits() {
+    MemoryDataStore data;
+    RateLimiter limiter(data);
+
+    for (int i = 0; i < kRateLimitBurst; ++i) {
+        QCOMPARE(limiter.Delay(kNow), 0LL);
+        limiter.OnRequestSent(kNow);
+    }
+    // 45:60 leaves 41 requests per minute once the burst is spent
+    QCOMPARE(limiter.Delay(kNow), 1464LL);
+    QCOMPARE(limiter.Delay(kNow + 1464), 0LL);
+}
+
+void TestRateLimiter::ParseHeaders() {
+    MemoryDataStore data;
+    RateLimiter limiter(data);
+    limiter.Update(MakeHeaders("10:5:10", "1:5:0"), kNow);
+    QCOMPARE(limiter.policy(), std::string("test-policy"));
+
+    for (int i = 0; i < kRateLimitBurst; ++i) {
+        QCOMPARE(limiter.Delay(kNow), 0LL);
+        limiter.OnRequestSent(kNow);
+    }
+    // 10:5 leaves 6 requests per 5 seconds once the burst is spent
+    QCOMPARE(limiter.Delay(kNow), 834LL);
+}
+
+void TestRateLimiter::ServerState() {
+    MemoryDataStore data;
+    RateLimiter limiter(data);
+    // Someone else already used up our budget
+    limiter.Update(MakeHeaders("10:5:10", "9:5:0"), kNow);
+    QCOMPARE(limiter.Delay(kNow), 834LL);
+}
+
+void TestRateLimiter::Restriction() {
+    MemoryDataStore data;
+    RateLimiter limiter(data);
+    limiter.Update(MakeHeaders("10:5:10", "11:5:10"), kNow);
+    QCOMPARE(limiter.Delay(kNow), 10000LL);
+    QCOMPARE(limiter.Delay(kNow + 10000), 0LL);
+}
+
+void TestRateLimiter::RetryAfter() {
+    MemoryDataStore data;
+    RateLimiter limiter(data);
+    RateLimiter::Headers headers;
+    headers["retry-after"] = "30";
+    limiter.Update(headers, kNow);
+    QCOMPARE(limiter.Delay(kNow), 30000LL);
+}
+
+void TestRateLimiter::Persistence() {
+    MemoryDataStore data;
+    RateLimiter limiter(data);
+    limiter.Update(MakeHeaders("10:5:10", "1:5:0"), kNow);
+    for (int i = 0; i < kRateLimitBurst; ++i)
+        limiter.OnRequestSent(kNow);
+    limiter.Save();
+
+    RateLimiter restored(data);
+    QCOMPARE(restored.policy(), limiter.policy());
+    QCOMPARE(restored.Delay(kNow), limiter.Delay(kNow));
+}
+
+void TestRateLimiter::MalformedState() {
+    MemoryDataStore data;
+    RateLimiter defaults(data);
+
+    // Buckets with fields of the wrong type are skipped rather than read
+    data.Set("rate_limit", "{\"policy\":\"test-policy\",\"buckets\":{"
+        "\"a\":{\"max_hits\":\"10\",\"period\":5,\"tokens\":0,\"updated\":0},"
+        "\"b\":{\"max_hits\":10,\"period\":5.5,\"tokens\":0,\"updated\":0},"
+        "\"c\":{\"max_hits\":10,\"period\":5,\"tokens\":null,\"updated\":0},"
+        "\"d\":{\"max_hits\":10,\"period\":5,\"tokens\":0,\"updated\":[]}}}");
+    RateLimiter restored(data);
+    QCOMPARE(restored.Delay(kNow), defaults.Delay(kNow));
+    for (int i = 0; i < kRateLimitBurst; ++i)
+        restored.OnRequestSent(kNow);
+    for (int i = 0; i < kRateLimitBurst; ++i)
+        defaults.OnRequestSent(kNow);
+    QCOMPARE(restored.Delay(kNow), defaults.Delay(kNow));
+}
+
+void TestRateLimiter::SaveOnChange() {
+    MemoryDataStore data;
+    RateLimiter limiter(data);
+    limiter.Update(MakeHeaders("10:5:10", "1:5:0"), kNow);
+    std::string saved = data.Get("rate_limit");
+    QVERIFY(!saved.empty());
+
+    // Requests and unchanged limits don't write anything
+    limiter.OnRequestSent(kNow);
+    limiter.Update(MakeHeaders("10:5:10", "2:5:0"), kNow);
+    QCOMPARE(data.Get("rate_limit"), saved);
+
+    // A restriction does
+    limiter.Update(MakeHeaders("10:5:10", "11:5:10"), kNow);
+    QVERIFY(data.Get("rate_limit") != saved);
+}
@@ -0,0 +1,94 @@
+/*
+    Copyright 2016 Ilya Zhuravlev
+
+    This file is part of Acquisition.
+
+    Acquisition is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Acquisition is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Acquisition.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "testrefreshcheckpoint.h"
+
+#include "memorydatastore.h"
+#include "refreshcheckpoint.h"
+
+const qint64 kStart = 1000000;
+const char *kKey = "refresh_checkpoint";
+
+static ItemLocation Character(const std::string &name) {
+    ItemLocation location;
+    location.set_type(ItemLocationType::CHARACTER);
+    location.set_character(name);
+    return location;
+}
+
+static void Interrupt(DataStore &data) {
+    RefreshCheckpoint checkpoint(data);
+    QVERIFY(!checkpoint.Start(TabCache::DefaultCache, kStart));
+    checkpoint.Add(ItemLocation(1, "Tab", ItemLocationType::STASH), 11);
+    checkpoint.Add(Character("Someone"), 22);
+    // What AbortUpdate does
+    checkpoint.Save();
+}
+
+void TestRefreshCheckpoint::Resume() {
+    MemoryDataStore data;
+    Interrupt(data);
+
+    RefreshCheckpoint checkpoint(data);
+    QVERIFY(checkpoint.Start(TabCache::DefaultCache, kStart + 1000));
+    auto &locations = checkpoint.locations();
+    QCOMPARE(locations.size(), static_cast<size_t>(2));
+    QCOMPARE(locations.at(ItemLocation(1, "Tab", ItemLocationType::STASH)), static_cast<quint64>(11));
+    QCOMPARE(locations.at(Character("Someone")), static_cast<quint64>(22));
+
+    checkpoint.Clear();
+    QCOMPARE(data.Get(kKey), std::string());
+}
+
+void TestRefreshCheckpoint::ExplicitRefresh() {
+    for (auto policy : { TabCache::NeverCache, TabCache::ManualCache }) {
+        MemoryDataStore data;
+        Interrupt(data);
+
+        // Refreshes the user asked for fetch everything again
+        RefreshCheckpoint checkpoint(data);
+        QVERIFY(!checkpoint.Start(policy, kStart + 1000));
+        QVERIFY(checkpoint.locations().empty());
+        QCOMPARE(data.Get(kKey), std::string());
+        // and don't leave anything for the next one
+        checkpoint.Add(Character("Someone"), 22);
+        checkpoint.Save();
+        RefreshCheckpoint next(data);
+        QVERIFY(!next.Start(TabCache::DefaultCache, kStart + 2000));
+    }
+}
+
+void TestRefreshCheckpoint::Outdated() {
+    MemoryDataStore data;
+    Interrupt(data);
+    RefreshCheckpoint checkpoint(data);
+    QVERIFY(!checkpoint.Start(TabCache::DefaultCache, kStart + 2 * 60 * 60 * 1000));
+    QVERIFY(checkpoint.locations().empty());
+}
+
+void TestRefreshCheckpoint::BatchedWrites() {
+    MemoryDataStore data;
+    RefreshCheckpoint checkpoint(data);
+    checkpoint.Start(TabCache::DefaultCache, kStart);
+    checkpoint.Add(Character("First"), 1);
+    QCOMPARE(data.Get(kKey), std::string());
+    for (int i = 0; i < 20; ++i)
+        checkpoint.Add(ItemLocation(i, "Tab", ItemLocationType::STASH), i + 1);
+    QVERIFY(!data.Get(kKey).empty());
+}
@@ -0,0 +1,57 @@
+/*
+    Copyright 2016 Ilya Zhuravlev
+
+    This file is part of Acquisition.
+
+    Acquisition is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Acquisition is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Acquisition.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "testtrigramindex.h"
+
+#include <cstdint>
+#include <vector>
+
+#include "trigramindex.h"
+
+void TestTrigramIndex::Candidates() {
+    TrigramIndex index;
+    index.Add(0, "Tabula Rasa");
+    index.Add(1, "Kaom's Heart");
+    index.Add(2, "Rare Leather Belt");
+
+    std::vector<uint32_t> candidates;
+    QVERIFY(index.Candidates("rasa", &candidates));
+    QCOMPARE(candidates, std::vector<uint32_t>({ 0 }));
+    // Case doesn't matter
+    QVERIFY(index.Candidates("HEART", &candidates));
+    QCOMPARE(candidates, std::vector<uint32_t>({ 1 }));
+    QVERIFY(index.Candidates("ra", &candidates) == false);
+    QVERIFY(index.Candidates("rar", &candidates));
+    QCOMPARE(candidates, std::vector<uint32_t>({ 2 }));
+    // A trigram nobody has
+    QVERIFY(index.Candidates("xyz", &candidates));
+    QVERIFY(candidates.empty());
+    // Candidates have all trigrams but may still not contain the query
+    index.Add(3, "abcd bcde");
+    QVERIFY(index.Candidates("abcde", &candidates));
+    QCOMPARE(candidates, std::vector<uint32_t>({ 3 }));
+}
+
+void TestTrigramIndex::ShortQuery() {
+    TrigramIndex index;
+    index.Add(0, "ab");
+    std::vector<uint32_t> candidates;
+    QVERIFY(index.Candidates("ab", &candidates) == false);
+    QVERIFY(index.Candidates("", &candidates) == false);
+}
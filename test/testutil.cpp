@@ -33,3 +33,9 @@ void TestUtil::TestModMatcher() {
     QVERIFY(Util::MatchMod("Adds #-# Physical Damage", "Adds 1.5-3.2 Physical Damage", &result));
     QCOMPAREDOUBLE(result, (1.5 + 3.2) / 2);
 }
+
+void TestUtil::TestFastHash() {
+    QCOMPARE(Util::FastHash("", 0), 14695981039346656037ULL);
+    QCOMPARE(Util::FastHash("a", 1), 12638187200555641996ULL);
+    QVERIFY(Util::FastHash("{\"items\":[]}", 12) != Util::FastHash("{\"items\":[1]}", 13));
+}